@@ -1,23 +1,158 @@
 #pragma once
+#include <coronet/cancellation.h>
+#include <coronet/frame.h>
+#include <array>
 #include <atomic>
 #include <exception>
 #include <experimental/coroutine>
 #include <functional>
 #include <iterator>
 #include <optional>
+#include <tuple>
 #include <type_traits>
 #include <utility>
+#include <vector>
 #include <cassert>
 
 namespace coronet {
 
 using std::experimental::coroutine_handle;
+using std::experimental::noop_coroutine;
 using std::experimental::suspend_always;
 using std::experimental::suspend_never;
 
+// Tag that makes a task join the task_scope that follows it (see task_scope).
+struct scope_arg_t {
+  explicit scope_arg_t() = default;
+};
+
+inline constexpr scope_arg_t scope_arg{};
+
+// Tracks tasks that take scope_arg and the scope as their first arguments (after the object for member functions).
+// The tasks register with the scope when they start and unregister when they complete without allocating.
+// Tasks that take the scope without the tag are not tracked, so they can wait for the scope.
+// Must outlive the tasks and must only be used on the thread that runs their events queue.
+class task_scope final {
+public:
+  class join_operation final {
+  public:
+    explicit join_operation(task_scope& scope) noexcept : scope_(scope) {
+    }
+
+    bool await_ready() noexcept {
+      return !scope_.size_;
+    }
+
+    void await_suspend(coroutine_handle<> handle) noexcept {
+      handle_ = handle;
+      next_ = std::exchange(scope_.joiners_, this);
+    }
+
+    constexpr void await_resume() noexcept {
+    }
+
+  private:
+    friend class task_scope;
+
+    task_scope& scope_;
+    coroutine_handle<> handle_ = nullptr;
+    join_operation* next_ = nullptr;
+  };
+
+  task_scope() noexcept = default;
+
+  task_scope(task_scope&& other) = delete;
+  task_scope& operator=(task_scope&& other) = delete;
+
+  ~task_scope() = default;
+
+  // Returns the number of tasks that did not complete yet.
+  std::size_t size() const noexcept {
+    return size_;
+  }
+
+  // Returns token that the tasks can pass to operations that should stop when the scope is cancelled.
+  cancellation_token token() noexcept {
+    return source_.token();
+  }
+
+  // Returns true if cancellation was requested.
+  bool cancelled() const noexcept {
+    return source_.cancelled();
+  }
+
+  // Requests cancellation of all operations that were started with tokens of this scope.
+  // Must be called on the thread that runs the events queue of the tasks. Other threads must post it.
+  void cancel() noexcept {
+    source_.cancel();
+  }
+
+  // Returns awaitable that waits until all tasks completed.
+  join_operation join() noexcept {
+    return join_operation(*this);
+  }
+
+private:
+  friend class task;
+
+  void enter() noexcept {
+    size_++;
+  }
+
+  // Returns the coroutine that waits for the last task or noop_coroutine().
+  coroutine_handle<> leave() noexcept {
+    if (--size_ || !joiners_) {
+      return noop_coroutine();
+    }
+    auto joiner = std::exchange(joiners_, nullptr);
+    while (joiner->next_) {
+      const auto next = joiner->next_;
+      joiner->handle_.resume();
+      joiner = next;
+    }
+    return joiner->handle_;
+  }
+
+  cancellation_source source_;
+  join_operation* joiners_ = nullptr;
+  std::size_t size_ = 0;
+};
+
+// Eagerly started coroutine that nobody waits for.
+// Tasks that take scope_arg and a task_scope as their first arguments are tracked by it (see task_scope).
 class task {
 public:
-  struct promise_type {
+  struct promise_type : frame {
+    // Unregisters the task from its scope after the coroutine frame was destroyed.
+    struct final_awaitable {
+      bool await_ready() noexcept {
+        return !scope_;
+      }
+
+      coroutine_handle<> await_suspend(coroutine_handle<promise_type> handle) noexcept {
+        const auto scope = scope_;
+        handle.destroy();
+        return scope->leave();
+      }
+
+      constexpr void await_resume() noexcept {
+      }
+
+      task_scope* scope_;
+    };
+
+    promise_type() noexcept = default;
+
+    template <typename... Args>
+    promise_type(scope_arg_t, task_scope& scope, Args&...) noexcept : scope_(&scope) {
+      scope.enter();
+    }
+
+    template <typename Class, typename... Args>
+    promise_type(Class&, scope_arg_t, task_scope& scope, Args&...) noexcept : scope_(&scope) {
+      scope.enter();
+    }
+
     task get_return_object() noexcept {
       return {};
     }
@@ -26,8 +161,8 @@ public:
       return suspend_never{};
     }
 
-    constexpr auto final_suspend() noexcept {
-      return suspend_never{};
+    auto final_suspend() noexcept {
+      return final_awaitable{ scope_ };
     }
 
     constexpr void return_void() noexcept {
@@ -36,13 +171,34 @@ public:
     void unhandled_exception() noexcept {
       std::abort();
     }
+
+    task_scope* scope_ = nullptr;
   };
 };
 
+// Eagerly started coroutine that returns a value.
+// The coroutine frame is owned by the async object and resumes the awaiting coroutine with symmetric transfer.
 template <typename T>
 class async {
 public:
-  struct promise_type {
+  struct promise_type : frame {
+    // Transfers execution to the awaiting coroutine when the coroutine completes.
+    struct final_awaitable {
+      constexpr bool await_ready() noexcept {
+        return false;
+      }
+
+      coroutine_handle<> await_suspend(coroutine_handle<promise_type> handle) noexcept {
+        if (const auto continuation = handle.promise().handle_) {
+          return continuation;
+        }
+        return noop_coroutine();
+      }
+
+      constexpr void await_resume() noexcept {
+      }
+    };
+
     async get_return_object() noexcept {
       return { *this };
     }
@@ -52,14 +208,11 @@ public:
     }
 
     constexpr auto final_suspend() noexcept {
-      return suspend_never{};
+      return final_awaitable{};
     }
 
     void return_value(T value) noexcept {
-      value_ = std::move(value);
-      if (auto handle = std::exchange(handle_, nullptr)) {
-        handle.resume();
-      }
+      value_.emplace(std::move(value));
     }
 
     void unhandled_exception() noexcept {
@@ -80,30 +233,530 @@ public:
 
   async& operator=(async&& other) noexcept {
     if (&other != this) {
+      if (handle_) {
+        handle_.destroy();
+      }
       handle_ = std::exchange(other.handle_, nullptr);
     }
+    return *this;
   }
 
-  ~async() = default;
+  ~async() {
+    if (handle_) {
+      handle_.destroy();
+    }
+  }
 
   bool await_ready() noexcept {
-    return !handle_ || handle_.promise().value_;
+    return !handle_ || handle_.done();
   }
 
   void await_suspend(coroutine_handle<> handle) noexcept {
     handle_.promise().handle_ = handle;
   }
 
-  auto& await_resume() noexcept {
-    return *handle_.promise().value_;
+  T await_resume() noexcept {
+    return std::move(*handle_.promise().value_);
+  }
+
+private:
+  coroutine_handle<promise_type> handle_ = nullptr;
+};
+
+// Lazily started coroutine that returns a value.
+// The coroutine starts when it is awaited and resumes the awaiting coroutine with symmetric transfer.
+template <typename T>
+class lazy {
+public:
+  struct promise_type : frame {
+    // Transfers execution to the awaiting coroutine when the coroutine completes.
+    struct final_awaitable {
+      constexpr bool await_ready() noexcept {
+        return false;
+      }
+
+      coroutine_handle<> await_suspend(coroutine_handle<promise_type> handle) noexcept {
+        return handle.promise().handle_;
+      }
+
+      constexpr void await_resume() noexcept {
+      }
+    };
+
+    lazy get_return_object() noexcept {
+      return { *this };
+    }
+
+    constexpr auto initial_suspend() noexcept {
+      return suspend_always{};
+    }
+
+    constexpr auto final_suspend() noexcept {
+      return final_awaitable{};
+    }
+
+    void return_value(T value) noexcept {
+      value_.emplace(std::move(value));
+    }
+
+    void unhandled_exception() noexcept {
+      std::abort();
+    }
+
+    std::optional<T> value_;
+    coroutine_handle<> handle_ = nullptr;
+  };
+
+  using handle_type = coroutine_handle<promise_type>;
+
+  lazy(promise_type& promise) noexcept : handle_(handle_type::from_promise(promise)) {
+  }
+
+  lazy(lazy&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {
+  }
+
+  lazy& operator=(lazy&& other) noexcept {
+    if (&other != this) {
+      if (handle_) {
+        handle_.destroy();
+      }
+      handle_ = std::exchange(other.handle_, nullptr);
+    }
+    return *this;
+  }
+
+  ~lazy() {
+    if (handle_) {
+      handle_.destroy();
+    }
+  }
+
+  bool await_ready() noexcept {
+    return !handle_ || handle_.done();
+  }
+
+  coroutine_handle<> await_suspend(coroutine_handle<> handle) noexcept {
+    handle_.promise().handle_ = handle;
+    return handle_;
+  }
+
+  T await_resume() noexcept {
+    return std::move(*handle_.promise().value_);
+  }
+
+private:
+  coroutine_handle<promise_type> handle_ = nullptr;
+};
+
+namespace detail {
+
+// Counts down the operations of when_all and when_any and resumes the awaiting coroutine after the last one.
+class latch {
+public:
+  explicit latch(std::size_t count) noexcept : count_(count + 1) {
+  }
+
+  // Starts waiting for the operations. Returns false if all operations already completed.
+  bool wait(coroutine_handle<> handle) noexcept {
+    handle_ = handle;
+    return --count_ > 0;
+  }
+
+  // Returns the coroutine to transfer to when an operation completes.
+  coroutine_handle<> arrive() noexcept {
+    if (--count_ > 0) {
+      return noop_coroutine();
+    }
+    return handle_;
+  }
+
+private:
+  std::size_t count_;
+  coroutine_handle<> handle_ = nullptr;
+};
+
+// Coroutine that runs an operation of when_all or when_any and notifies the latch when it completes.
+class driver {
+public:
+  struct promise_type : frame {
+    // Transfers execution to the awaiting coroutine when the last operation completes.
+    struct final_awaitable {
+      constexpr bool await_ready() noexcept {
+        return false;
+      }
+
+      coroutine_handle<> await_suspend(coroutine_handle<promise_type> handle) noexcept {
+        return handle.promise().latch_->arrive();
+      }
+
+      constexpr void await_resume() noexcept {
+      }
+    };
+
+    driver get_return_object() noexcept {
+      return driver(coroutine_handle<promise_type>::from_promise(*this));
+    }
+
+    constexpr auto initial_suspend() noexcept {
+      return suspend_always{};
+    }
+
+    constexpr auto final_suspend() noexcept {
+      return final_awaitable{};
+    }
+
+    constexpr void return_void() noexcept {
+    }
+
+    void unhandled_exception() noexcept {
+      std::abort();
+    }
+
+    latch* latch_ = nullptr;
+  };
+
+  driver(driver&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {
+  }
+
+  driver& operator=(driver&& other) = delete;
+
+  ~driver() {
+    if (handle_) {
+      handle_.destroy();
+    }
+  }
+
+  // Runs the operation until it completes or suspends.
+  void start(latch& latch) noexcept {
+    handle_.promise().latch_ = &latch;
+    handle_.resume();
   }
 
 private:
+  explicit driver(coroutine_handle<promise_type> handle) noexcept : handle_(handle) {
+  }
+
   coroutine_handle<promise_type> handle_ = nullptr;
 };
 
+// Awaitable that starts the drivers and resumes the awaiting coroutine when all of them completed.
+class join {
+public:
+  join(driver* drivers, std::size_t size) noexcept : drivers_(drivers), size_(size), latch_(size) {
+  }
+
+  constexpr bool await_ready() noexcept {
+    return false;
+  }
+
+  bool await_suspend(coroutine_handle<> handle) noexcept {
+    for (std::size_t i = 0; i < size_; i++) {
+      drivers_[i].start(latch_);
+    }
+    return latch_.wait(handle);
+  }
+
+  constexpr void await_resume() noexcept {
+  }
+
+private:
+  driver* drivers_;
+  std::size_t size_;
+  latch latch_;
+};
+
+// clang-format off
+
+template <typename T>
+driver drive(lazy<T>& task, std::optional<T>& result) {
+  result.emplace(co_await task);
+}
+
+template <typename T>
+driver drive(
+  lazy<T>& task, std::optional<T>& result, std::size_t index, std::size_t& winner, cancellation_source& source) {
+  auto value = co_await task;
+  if (!result) {
+    result.emplace(std::move(value));
+    winner = index;
+    source.cancel();
+  }
+}
+
+template <typename... T, std::size_t... I>
+lazy<std::tuple<T...>> when_all(std::index_sequence<I...>, lazy<T>... tasks) {
+  std::tuple<std::optional<T>...> results;
+  std::array<driver, sizeof...(T)> drivers{ drive(tasks, std::get<I>(results))... };
+  co_await join(drivers.data(), drivers.size());
+  co_return std::tuple<T...>(std::move(*std::get<I>(results))...);
+}
+
+// clang-format on
+
+}  // namespace detail
+
+// clang-format off
+
+// Runs the tasks concurrently on the current thread and returns their results after all of them completed.
+template <typename... T>
+lazy<std::tuple<T...>> when_all(lazy<T>... tasks) {
+  return detail::when_all(std::index_sequence_for<T...>{}, std::move(tasks)...);
+}
+
+// Runs the tasks concurrently on the current thread and returns their results after all of them completed.
+template <typename T>
+lazy<std::vector<T>> when_all(std::vector<lazy<T>> tasks) {
+  std::vector<std::optional<T>> results(tasks.size());
+  std::vector<detail::driver> drivers;
+  drivers.reserve(tasks.size());
+  for (std::size_t i = 0; i < tasks.size(); i++) {
+    drivers.push_back(detail::drive(tasks[i], results[i]));
+  }
+  co_await detail::join(drivers.data(), drivers.size());
+  std::vector<T> values;
+  values.reserve(results.size());
+  for (auto& result : results) {
+    values.push_back(std::move(*result));
+  }
+  co_return values;
+}
+
+// Runs the tasks concurrently on the current thread and returns the index and result of the first task that completes.
+// Cancels the source when the first task completes and returns after the remaining tasks completed, so the tasks
+// should observe tokens of the source. Must be called with at least one task.
+template <typename T>
+lazy<std::pair<std::size_t, T>> when_any(cancellation_source& source, std::vector<lazy<T>> tasks) {
+  assert(!tasks.empty());
+  std::optional<T> result;
+  std::size_t winner = 0;
+  std::vector<detail::driver> drivers;
+  drivers.reserve(tasks.size());
+  for (std::size_t i = 0; i < tasks.size(); i++) {
+    drivers.push_back(detail::drive(tasks[i], result, i, winner, source));
+  }
+  co_await detail::join(drivers.data(), drivers.size());
+  co_return std::pair<std::size_t, T>(winner, std::move(*result));
+}
+
+// clang-format on
+
+// Runs the tasks concurrently on the current thread and returns the index and result of the first task that completes.
+template <typename T, typename... Tasks>
+lazy<std::pair<std::size_t, T>> when_any(cancellation_source& source, lazy<T> task, Tasks... tasks) {
+  std::vector<lazy<T>> vector;
+  vector.reserve(sizeof...(Tasks) + 1);
+  vector.push_back(std::move(task));
+  (vector.push_back(std::move(tasks)), ...);
+  return when_any(source, std::move(vector));
+}
+
+// Asynchronous generator that is only resumed on a single thread.
+// The producer and the consumer hand execution to each other with symmetric transfer and without atomic operations.
+// Use async_generator for producers that are resumed on other threads.
+template <typename T>
+class local_async_generator {
+public:
+  using value_type = std::remove_reference_t<T>;
+  using reference = std::add_lvalue_reference_t<T>;
+  using pointer = std::add_pointer_t<value_type>;
+
+  class promise_type;
+  class iterator;
+
+  using handle_type = coroutine_handle<promise_type>;
+
+  // Transfers execution to the consumer when the producer yields a value or completes.
+  class yield_operation {
+  public:
+    explicit yield_operation(coroutine_handle<> consumer) noexcept : consumer_(consumer) {
+    }
+
+    constexpr bool await_ready() noexcept {
+      return false;
+    }
+
+    coroutine_handle<> await_suspend(coroutine_handle<> producer) noexcept {
+      return consumer_;
+    }
+
+    constexpr void await_resume() noexcept {
+    }
+
+  private:
+    coroutine_handle<> consumer_;
+  };
+
+  class promise_type : public frame {
+  public:
+    local_async_generator get_return_object() noexcept {
+      return local_async_generator(handle_type::from_promise(*this));
+    }
+
+    constexpr auto initial_suspend() noexcept {
+      return suspend_always{};
+    }
+
+    yield_operation final_suspend() noexcept {
+      value_ = nullptr;
+      return yield_operation(consumer_);
+    }
+
+    yield_operation yield_value(value_type& value) noexcept {
+      value_ = std::addressof(value);
+      return yield_operation(consumer_);
+    }
+
+    yield_operation yield_value(value_type&& value) noexcept {
+      return yield_value(value);
+    }
+
+    constexpr void return_void() noexcept {
+    }
+
+    void unhandled_exception() noexcept {
+      std::abort();
+    }
+
+    // Returns true if the producer completed.
+    bool finished() const noexcept {
+      return value_ == nullptr;
+    }
+
+    reference value() const noexcept {
+      return *value_;
+    }
+
+  private:
+    friend class local_async_generator;
+
+    coroutine_handle<> consumer_ = nullptr;
+    pointer value_ = nullptr;
+  };
+
+  // Transfers execution to the producer until it yields the next value or completes.
+  class advance_operation {
+  public:
+    explicit advance_operation(handle_type producer) noexcept : producer_(producer) {
+    }
+
+    bool await_ready() noexcept {
+      return !producer_;
+    }
+
+    coroutine_handle<> await_suspend(coroutine_handle<> consumer) noexcept {
+      producer_.promise().consumer_ = consumer;
+      return producer_;
+    }
+
+  protected:
+    handle_type producer_;
+  };
+
+  class begin_operation final : public advance_operation {
+  public:
+    using advance_operation::advance_operation;
+
+    iterator await_resume() noexcept {
+      if (!this->producer_ || this->producer_.promise().finished()) {
+        return iterator(nullptr);
+      }
+      return iterator(this->producer_);
+    }
+  };
+
+  class increment_operation final : public advance_operation {
+  public:
+    explicit increment_operation(iterator& position) noexcept :
+      advance_operation(position.producer_), iterator_(position) {
+    }
+
+    iterator& await_resume() noexcept {
+      if (this->producer_.promise().finished()) {
+        iterator_.producer_ = nullptr;
+      }
+      return iterator_;
+    }
+
+  private:
+    iterator& iterator_;
+  };
+
+  class iterator final {
+  public:
+    using iterator_category = std::input_iterator_tag;
+    using difference_type = std::size_t;
+    using value_type = local_async_generator::value_type;
+    using reference = local_async_generator::reference;
+    using pointer = local_async_generator::pointer;
+
+    explicit iterator(handle_type producer) noexcept : producer_(producer) {
+    }
+
+    increment_operation operator++() noexcept {
+      return increment_operation(*this);
+    }
+
+    reference operator*() const noexcept {
+      return producer_.promise().value();
+    }
+
+    bool operator==(const iterator& other) const noexcept {
+      return producer_ == other.producer_;
+    }
+
+    bool operator!=(const iterator& other) const noexcept {
+      return !(*this == other);
+    }
+
+  private:
+    friend class increment_operation;
+
+    handle_type producer_;
+  };
+
+  local_async_generator() noexcept = default;
+
+  local_async_generator(local_async_generator&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {
+  }
+
+  local_async_generator& operator=(local_async_generator&& other) noexcept {
+    if (&other != this) {
+      if (handle_) {
+        handle_.destroy();
+      }
+      handle_ = std::exchange(other.handle_, nullptr);
+    }
+    return *this;
+  }
+
+  // The producer is suspended while the consumer runs, either at a yield or in an operation that it awaits.
+  // Destroying it destroys the awaited operation, which must cancel or orphan its pending system call.
+  ~local_async_generator() {
+    if (handle_) {
+      handle_.destroy();
+    }
+  }
+
+  begin_operation begin() noexcept {
+    return begin_operation(handle_);
+  }
+
+  iterator end() noexcept {
+    return iterator(nullptr);
+  }
+
+private:
+  explicit local_async_generator(handle_type handle) noexcept : handle_(handle) {
+  }
+
+  handle_type handle_ = nullptr;
+};
+
 // ============================================================================
 // Everything below this line is from <https://github.com/lewissbaker/cppcoro>.
+// The async_generator state machine and its yield and advance operations were
+// modified to hand execution between the producer and the consumer with
+// symmetric transfer, and its promise allocates frames from the frame pool.
 // ============================================================================
 // Copyright 2017 Lewis Baker
 //
@@ -313,7 +966,7 @@ class async_generator_iterator;
 class async_generator_yield_operation;
 class async_generator_advance_operation;
 
-class async_generator_promise_base {
+class async_generator_promise_base : public frame {
 public:
   async_generator_promise_base() noexcept : m_state(state::value_ready_producer_suspended), m_exception(nullptr) {
     // Other variables left intentionally uninitialised as they're
@@ -386,30 +1039,25 @@ private:
   friend class async_generator_advance_operation;
 
   // State transition diagram
-  //   VNRCA - value_not_ready_consumer_active
   //   VNRCS - value_not_ready_consumer_suspended
-  //   VRPA  - value_ready_consumer_active
-  //   VRPS  - value_ready_consumer_suspended
+  //   VRPS  - value_ready_producer_suspended
   //
-  //       A         +---  VNRCA --[C]--> VNRCS   yield_value()
-  //       |         |     |  A           |  A       |   .
-  //       |        [C]   [P] |          [P] |       |   .
-  //       |         |     | [C]          | [C]      |   .
-  //       |         |     V  |           V  |       |   .
-  //  operator++/    |     VRPS <--[P]--- VRPA       V   |
-  //  begin()        |      |              |             |
-  //                 |     [C]            [C]            |
-  //                 |      +----+     +---+             |
-  //                 |           |     |                 |
-  //                 |           V     V                 V
-  //                 +--------> cancelled         ~async_generator()
+  //                 +-- VRPS --[C]--> VNRCS --+
+  //                 |    A                    |
+  //                 |    +--------[P]---------+
+  //                [C]
+  //                 |
+  //                 V
+  //             cancelled   ~async_generator()
   //
   // [C] - Consumer performs this transition
   // [P] - Producer performs this transition
+  //
+  // Consumer and producer hand execution to each other with symmetric transfer, so only one
+  // of them is active at a time and a synchronously produced value costs a tail call.
+  // The state is still atomic so that the producer can be resumed on a different thread.
   enum class state {
-    value_not_ready_consumer_active,
     value_not_ready_consumer_suspended,
-    value_ready_producer_active,
     value_ready_producer_suspended,
     cancelled
   };
@@ -428,22 +1076,20 @@ class async_generator_yield_operation final {
   using state = async_generator_promise_base::state;
 
 public:
-  async_generator_yield_operation(async_generator_promise_base& promise, state initialState) noexcept :
-    m_promise(promise), m_initialState(initialState) {
+  async_generator_yield_operation(async_generator_promise_base& promise) noexcept : m_promise(promise) {
   }
 
-  bool await_ready() const noexcept {
-    return m_initialState == state::value_not_ready_consumer_suspended;
+  constexpr bool await_ready() const noexcept {
+    return false;
   }
 
-  bool await_suspend(std::experimental::coroutine_handle<> producer) noexcept;
+  std::experimental::coroutine_handle<> await_suspend(std::experimental::coroutine_handle<> producer) noexcept;
 
   void await_resume() noexcept {
   }
 
 private:
   async_generator_promise_base& m_promise;
-  state m_initialState;
 };
 
 inline async_generator_yield_operation async_generator_promise_base::final_suspend() noexcept {
@@ -452,80 +1098,17 @@ inline async_generator_yield_operation async_generator_promise_base::final_suspe
 }
 
 inline async_generator_yield_operation async_generator_promise_base::internal_yield_value() noexcept {
-  state currentState = m_state.load(std::memory_order_acquire);
-  assert(currentState != state::value_ready_producer_active);
-  assert(currentState != state::value_ready_producer_suspended);
-
-  if (currentState == state::value_not_ready_consumer_suspended) {
-    // Only need relaxed memory order since we're resuming the
-    // consumer on the same thread.
-    m_state.store(state::value_ready_producer_active, std::memory_order_relaxed);
-
-    // Resume the consumer.
-    // It might ask for another value before returning, in which case it'll
-    // transition to value_not_ready_consumer_suspended and we can return from
-    // yield_value without suspending, otherwise we should try to suspend
-    // the producer in which case the consumer will wake us up again
-    // when it wants the next value.
-    m_consumerCoroutine.resume();
-
-    // Need to use acquire semantics here since it's possible that the
-    // consumer might have asked for the next value on a different thread
-    // which executed concurrently with the call to m_consumerCoro on the
-    // current thread above.
-    currentState = m_state.load(std::memory_order_acquire);
-  }
-
-  return async_generator_yield_operation{ *this, currentState };
+  return async_generator_yield_operation{ *this };
 }
 
-inline bool async_generator_yield_operation::await_suspend(std::experimental::coroutine_handle<> producer) noexcept {
-  state currentState = m_initialState;
-  if (currentState == state::value_not_ready_consumer_active) {
-    bool producerSuspended = m_promise.m_state.compare_exchange_strong(
-      currentState, state::value_ready_producer_suspended, std::memory_order_release, std::memory_order_acquire);
-    if (producerSuspended) {
-      return true;
-    }
-
-    if (currentState == state::value_not_ready_consumer_suspended) {
-      // Can get away with using relaxed memory semantics here since we're
-      // resuming the consumer on the current thread.
-      m_promise.m_state.store(state::value_ready_producer_active, std::memory_order_relaxed);
-
-      m_promise.m_consumerCoroutine.resume();
-
-      // The consumer might have asked for another value before returning, in which case
-      // it'll transition to value_not_ready_consumer_suspended and we can return without
-      // suspending, otherwise we should try to suspend the producer, in which case the
-      // consumer will wake us up again when it wants the next value.
-      //
-      // Need to use acquire semantics here since it's possible that the consumer might
-      // have asked for the next value on a different thread which executed concurrently
-      // with the call to m_consumerCoro.resume() above.
-      currentState = m_promise.m_state.load(std::memory_order_acquire);
-      if (currentState == state::value_not_ready_consumer_suspended) {
-        return false;
-      }
-    }
-  }
-
-  // By this point the consumer has been resumed if required and is now active.
-
-  if (currentState == state::value_ready_producer_active) {
-    // Try to suspend the producer.
-    // If we failed to suspend then it's either because the consumer destructed, transitioning
-    // the state to cancelled, or requested the next item, transitioning the state to value_not_ready_consumer_suspended.
-    const bool suspendedProducer = m_promise.m_state.compare_exchange_strong(
-      currentState, state::value_ready_producer_suspended, std::memory_order_release, std::memory_order_acquire);
-    if (suspendedProducer) {
-      return true;
-    }
-
-    if (currentState == state::value_not_ready_consumer_suspended) {
-      // Consumer has asked for the next value.
-      return false;
-    }
+inline std::experimental::coroutine_handle<> async_generator_yield_operation::await_suspend(
+  std::experimental::coroutine_handle<> producer) noexcept {
+  // The consumer is suspended in an advance operation. Suspend the producer and transfer
+  // execution to the consumer unless the async_generator object was destroyed.
+  auto currentState = state::value_not_ready_consumer_suspended;
+  if (m_promise.m_state.compare_exchange_strong(
+        currentState, state::value_ready_producer_suspended, std::memory_order_acq_rel, std::memory_order_acquire)) {
+    return m_promise.m_consumerCoroutine;
   }
 
   assert(currentState == state::cancelled);
@@ -535,7 +1118,7 @@ inline bool async_generator_yield_operation::await_suspend(std::experimental::co
   // the coroutine.
   producer.destroy();
 
-  return true;
+  return std::experimental::noop_coroutine();
 }
 
 class async_generator_advance_operation {
@@ -549,73 +1132,26 @@ protected:
     async_generator_promise_base& promise, std::experimental::coroutine_handle<> producerCoroutine) noexcept :
     m_promise(std::addressof(promise)),
     m_producerCoroutine(producerCoroutine) {
-    state initialState = promise.m_state.load(std::memory_order_acquire);
-    if (initialState == state::value_ready_producer_suspended) {
-      // Can use relaxed memory order here as we will be resuming the producer
-      // on the same thread.
-      promise.m_state.store(state::value_not_ready_consumer_active, std::memory_order_relaxed);
-
-      producerCoroutine.resume();
-
-      // Need to use acquire memory order here since it's possible that the
-      // coroutine may have transferred execution to another thread and
-      // completed on that other thread before the call to resume() returns.
-      initialState = promise.m_state.load(std::memory_order_acquire);
-    }
-
-    m_initialState = initialState;
   }
 
 public:
-  bool await_ready() const noexcept {
-    return m_initialState == state::value_ready_producer_suspended;
+  constexpr bool await_ready() const noexcept {
+    return false;
   }
 
-  bool await_suspend(std::experimental::coroutine_handle<> consumerCoroutine) noexcept {
+  std::experimental::coroutine_handle<> await_suspend(
+    std::experimental::coroutine_handle<> consumerCoroutine) noexcept {
+    // The producer is suspended at its initial suspend point or at a co_yield statement.
+    // Suspend the consumer and transfer execution to the producer.
+    assert(m_promise->m_state.load(std::memory_order_relaxed) == state::value_ready_producer_suspended);
     m_promise->m_consumerCoroutine = consumerCoroutine;
-
-    auto currentState = m_initialState;
-    if (currentState == state::value_ready_producer_active) {
-      // A potential race between whether consumer or producer coroutine
-      // suspends first. Resolve the race using a compare-exchange.
-      if (m_promise->m_state.compare_exchange_strong(
-            currentState, state::value_not_ready_consumer_suspended, std::memory_order_release,
-            std::memory_order_acquire)) {
-        return true;
-      }
-
-      assert(currentState == state::value_ready_producer_suspended);
-
-      m_promise->m_state.store(state::value_not_ready_consumer_active, std::memory_order_relaxed);
-
-      m_producerCoroutine.resume();
-
-      currentState = m_promise->m_state.load(std::memory_order_acquire);
-      if (currentState == state::value_ready_producer_suspended) {
-        // Producer coroutine produced a value synchronously.
-        return false;
-      }
-    }
-
-    assert(currentState == state::value_not_ready_consumer_active);
-
-    // Try to suspend consumer coroutine, transitioning to value_not_ready_consumer_suspended.
-    // This could be racing with producer making the next value available and suspending
-    // (transition to value_ready_producer_suspended) so we use compare_exchange to decide who
-    // wins the race.
-    // If compare_exchange succeeds then consumer suspended (and we return true).
-    // If it fails then producer yielded next value and suspended and we can return
-    // synchronously without suspended (ie. return false).
-    return m_promise->m_state.compare_exchange_strong(
-      currentState, state::value_not_ready_consumer_suspended, std::memory_order_release, std::memory_order_acquire);
+    m_promise->m_state.store(state::value_not_ready_consumer_suspended, std::memory_order_release);
+    return m_producerCoroutine;
   }
 
 protected:
   async_generator_promise_base* m_promise;
   std::experimental::coroutine_handle<> m_producerCoroutine;
-
-private:
-  state m_initialState;
 };
 
 template <typename T>
@@ -738,7 +1274,7 @@ public:
   }
 
   bool await_ready() const noexcept {
-    return m_promise == nullptr || async_generator_advance_operation::await_ready();
+    return m_promise == nullptr;
   }
 
   async_generator_iterator<T> await_resume() {
@@ -0,0 +1,145 @@
+#pragma once
+
+namespace coronet {
+
+class cancellation_source;
+
+// Intrusive callback that is registered with a cancellation source.
+class cancellation_callback {
+public:
+  cancellation_callback() noexcept = default;
+
+  cancellation_callback(cancellation_callback&& other) = delete;
+  cancellation_callback& operator=(cancellation_callback&& other) = delete;
+
+  // Called when the cancellation source is cancelled.
+  virtual void operator()() noexcept = 0;
+
+  // Returns true if the callback is registered with a cancellation source.
+  bool registered() const noexcept {
+    return source_ != nullptr;
+  }
+
+  // Unregisters the callback.
+  void reset() noexcept;
+
+protected:
+  ~cancellation_callback() {
+    reset();
+  }
+
+private:
+  friend class cancellation_source;
+  friend class cancellation_token;
+
+  cancellation_source* source_ = nullptr;
+  cancellation_callback* prev_ = nullptr;
+  cancellation_callback* next_ = nullptr;
+};
+
+// Token that lets an operation observe a cancellation source.
+// Default constructed tokens are never cancelled.
+class cancellation_token {
+public:
+  cancellation_token() noexcept = default;
+
+  // Returns true if cancellation was requested.
+  bool cancelled() const noexcept;
+
+  // Registers the callback with the cancellation source.
+  // Returns false without registering the callback if cancellation was already requested.
+  bool attach(cancellation_callback& callback) const noexcept;
+
+private:
+  friend class cancellation_source;
+
+  explicit cancellation_token(cancellation_source* source) noexcept : source_(source) {
+  }
+
+  cancellation_source* source_ = nullptr;
+};
+
+// Cancels the operations that were started with its tokens.
+// Must outlive the operations and must only be used on the thread that runs their events queue.
+// The callbacks run inline in cancel and access the events queue, its timing wheel and its sockets.
+// Other threads must post a work item that calls cancel to the events queue of the operations.
+class cancellation_source {
+public:
+  cancellation_source() noexcept = default;
+
+  cancellation_source(cancellation_source&& other) = delete;
+  cancellation_source& operator=(cancellation_source&& other) = delete;
+
+  ~cancellation_source() {
+    while (head_) {
+      head_->reset();
+    }
+  }
+
+  // Returns token that observes this cancellation source.
+  cancellation_token token() noexcept {
+    return cancellation_token(this);
+  }
+
+  // Returns true if cancellation was requested.
+  bool cancelled() const noexcept {
+    return cancelled_;
+  }
+
+  // Requests cancellation and calls all registered callbacks on the current thread.
+  // Must be called on the thread that runs the events queue of the operations.
+  void cancel() noexcept {
+    cancelled_ = true;
+    while (const auto callback = head_) {
+      callback->reset();
+      (*callback)();
+    }
+  }
+
+private:
+  friend class cancellation_callback;
+  friend class cancellation_token;
+
+  cancellation_callback* head_ = nullptr;
+  bool cancelled_ = false;
+};
+
+inline void cancellation_callback::reset() noexcept {
+  if (!source_) {
+    return;
+  }
+  if (prev_) {
+    prev_->next_ = next_;
+  } else {
+    source_->head_ = next_;
+  }
+  if (next_) {
+    next_->prev_ = prev_;
+  }
+  source_ = nullptr;
+  prev_ = nullptr;
+  next_ = nullptr;
+}
+
+inline bool cancellation_token::cancelled() const noexcept {
+  return source_ && source_->cancelled_;
+}
+
+inline bool cancellation_token::attach(cancellation_callback& callback) const noexcept {
+  callback.reset();
+  if (!source_) {
+    return true;
+  }
+  if (source_->cancelled_) {
+    return false;
+  }
+  callback.source_ = source_;
+  callback.next_ = source_->head_;
+  if (callback.next_) {
+    callback.next_->prev_ = &callback;
+  }
+  source_->head_ = &callback;
+  return true;
+}
+
+}  // namespace coronet
@@ -0,0 +1,407 @@
+#pragma once
+#include <coronet/async.h>
+#include <coronet/error.h>
+#include <coronet/events.h>
+#include <coronet/work.h>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <cstddef>
+
+namespace coronet {
+
+// Number of coroutines that may send to a channel at the same time.
+enum class producers {
+  single,
+  multiple,
+};
+
+namespace detail {
+
+// Rounds the capacity up to a power of two.
+constexpr std::size_t ring_capacity(std::size_t capacity) noexcept {
+  std::size_t size = 1;
+  while (size < capacity) {
+    size <<= 1;
+  }
+  return size;
+}
+
+// Bounded lock-free single producer single consumer ring buffer.
+template <typename T>
+class spsc_ring final {
+public:
+  explicit spsc_ring(std::size_t capacity) :
+    mask_(ring_capacity(capacity) - 1), cells_(std::make_unique<cell[]>(mask_ + 1)) {
+  }
+
+  spsc_ring(spsc_ring&& other) = delete;
+  spsc_ring& operator=(spsc_ring&& other) = delete;
+
+  ~spsc_ring() {
+    while (try_pop()) {
+    }
+  }
+
+  // Called by the producer.
+  bool try_push(T& value) noexcept {
+    const auto tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) > mask_) {
+      return false;
+    }
+    new (cells_[tail & mask_].data) T(std::move(value));
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Called by the consumer.
+  std::optional<T> try_pop() noexcept {
+    const auto head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) {
+      return std::nullopt;
+    }
+    const auto data = std::launder(reinterpret_cast<T*>(cells_[head & mask_].data));
+    std::optional<T> value(std::move(*data));
+    data->~T();
+    head_.store(head + 1, std::memory_order_release);
+    return value;
+  }
+
+  // Returns true if the ring buffer was full. Called by the producer.
+  bool full() const noexcept {
+    return tail_.load(std::memory_order_relaxed) - head_.load(std::memory_order_acquire) > mask_;
+  }
+
+  // Returns true if the ring buffer was empty. Called by the consumer.
+  bool empty() const noexcept {
+    return head_.load(std::memory_order_relaxed) == tail_.load(std::memory_order_acquire);
+  }
+
+private:
+  struct cell {
+    alignas(T) unsigned char data[sizeof(T)];
+  };
+
+  const std::size_t mask_;
+  std::unique_ptr<cell[]> cells_;
+  alignas(64) std::atomic<std::size_t> head_ = 0;
+  alignas(64) std::atomic<std::size_t> tail_ = 0;
+};
+
+// Bounded lock-free multiple producer single consumer ring buffer.
+// Every cell has a sequence number that tells producers and the consumer whose turn it is.
+template <typename T>
+class mpsc_ring final {
+public:
+  explicit mpsc_ring(std::size_t capacity) :
+    mask_(ring_capacity(capacity) - 1), cells_(std::make_unique<cell[]>(mask_ + 1)) {
+    for (std::size_t i = 0; i <= mask_; i++) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  mpsc_ring(mpsc_ring&& other) = delete;
+  mpsc_ring& operator=(mpsc_ring&& other) = delete;
+
+  ~mpsc_ring() {
+    while (try_pop()) {
+    }
+  }
+
+  // Called by any producer.
+  bool try_push(T& value) noexcept {
+    auto tail = tail_.load(std::memory_order_relaxed);
+    while (true) {
+      auto& cell = cells_[tail & mask_];
+      const auto sequence = cell.sequence.load(std::memory_order_acquire);
+      const auto difference = static_cast<std::ptrdiff_t>(sequence - tail);
+      if (difference < 0) {
+        return false;
+      }
+      if (difference > 0) {
+        tail = tail_.load(std::memory_order_relaxed);
+        continue;
+      }
+      if (tail_.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed)) {
+        new (cell.data) T(std::move(value));
+        cell.sequence.store(tail + 1, std::memory_order_release);
+        return true;
+      }
+    }
+  }
+
+  // Called by the consumer.
+  std::optional<T> try_pop() noexcept {
+    auto& cell = cells_[head_ & mask_];
+    if (cell.sequence.load(std::memory_order_acquire) != head_ + 1) {
+      return std::nullopt;
+    }
+    const auto data = std::launder(reinterpret_cast<T*>(cell.data));
+    std::optional<T> value(std::move(*data));
+    data->~T();
+    cell.sequence.store(head_ + mask_ + 1, std::memory_order_release);
+    head_++;
+    return value;
+  }
+
+  // Returns true if the ring buffer was full. Called by any producer.
+  bool full() const noexcept {
+    const auto tail = tail_.load(std::memory_order_relaxed);
+    const auto sequence = cells_[tail & mask_].sequence.load(std::memory_order_acquire);
+    return static_cast<std::ptrdiff_t>(sequence - tail) < 0;
+  }
+
+  // Returns true if the ring buffer was empty. Called by the consumer.
+  bool empty() const noexcept {
+    return cells_[head_ & mask_].sequence.load(std::memory_order_acquire) != head_ + 1;
+  }
+
+private:
+  struct cell {
+    std::atomic<std::size_t> sequence;
+    alignas(T) unsigned char data[sizeof(T)];
+  };
+
+  const std::size_t mask_;
+  std::unique_ptr<cell[]> cells_;
+  alignas(64) std::size_t head_ = 0;
+  alignas(64) std::atomic<std::size_t> tail_ = 0;
+};
+
+}  // namespace detail
+
+// Bounded lock-free channel that hands values from producer coroutines to a single consumer coroutine.
+// Producers and the consumer can run on different events queues. Waiting coroutines are resumed on the events queue
+// that they were suspended on (or on the waking thread if they do not run on an events queue). The consumer is only
+// woken up when it waits for a value, so a burst of values costs a single wakeup.
+template <typename T, producers Producers = producers::multiple>
+class channel final {
+public:
+  class sender;
+  class receiver;
+
+  // Creates channel that buffers at least the given number of values.
+  explicit channel(std::size_t capacity) : ring_(capacity) {
+  }
+
+  channel(channel&& other) = delete;
+  channel& operator=(channel&& other) = delete;
+
+  ~channel() = default;
+
+  // Returns awaitable that waits for space in the channel and sends the value.
+  // The awaitable returns errc::closed when the channel is closed.
+  sender send(T value) noexcept {
+    return sender(*this, std::move(value));
+  }
+
+  // Returns awaitable that waits for the next value.
+  // The awaitable returns std::nullopt when the channel is closed and all values were received.
+  receiver recv() noexcept {
+    return receiver(*this);
+  }
+
+  // Receives values until the channel is closed and all values were received.
+  local_async_generator<T> values() noexcept;
+
+  // Closes the channel and wakes up all waiting coroutines. Can be called from any thread.
+  void close() noexcept {
+    closed_.store(true, std::memory_order_seq_cst);
+    wake_consumer();
+    wake_producers();
+  }
+
+  // Returns true if the channel is closed.
+  bool closed() const noexcept {
+    return closed_.load(std::memory_order_acquire);
+  }
+
+  class sender final : public work {
+  public:
+    sender(channel& channel, T value) noexcept : channel_(channel), value_(std::move(value)) {
+    }
+
+    bool await_ready() noexcept {
+      return push();
+    }
+
+    void await_suspend(coroutine_handle<> handle) noexcept {
+      handle_ = handle;
+      events_ = events::current();
+      wait();
+    }
+
+    std::error_code await_resume() noexcept {
+      return ec_;
+    }
+
+    // Retries sending the value when the consumer made space in the channel.
+    void operator()() noexcept override {
+      if (push()) {
+        handle_.resume();
+        return;
+      }
+      wait();
+    }
+
+  private:
+    friend class channel;
+
+    // Sends the value. Returns false if the channel is full.
+    bool push() noexcept {
+      if (channel_.closed()) {
+        ec_ = errc::closed;
+        return true;
+      }
+      if (!channel_.ring_.try_push(value_)) {
+        return false;
+      }
+      channel_.wake_consumer();
+      return true;
+    }
+
+    // Registers the sender as waiting and checks if the consumer made space or closed the channel in the meantime.
+    void wait() noexcept {
+      auto head = channel_.producers_.load(std::memory_order_relaxed);
+      do {
+        next_ = head;
+      } while (!channel_.producers_.compare_exchange_weak(
+        head, this, std::memory_order_seq_cst, std::memory_order_relaxed));
+      if (!channel_.ring_.full() || channel_.closed()) {
+        channel_.wake_producers();
+      }
+    }
+
+    // Resumes the sender on its events queue.
+    void wake() noexcept {
+      if (events_) {
+        events_->post(*this);
+      } else {
+        (*this)();
+      }
+    }
+
+    channel& channel_;
+    T value_;
+    std::error_code ec_;
+    coroutine_handle<> handle_ = nullptr;
+    events* events_ = nullptr;
+    sender* next_ = nullptr;
+  };
+
+  class receiver final : public work {
+  public:
+    explicit receiver(channel& channel) noexcept : channel_(channel) {
+    }
+
+    bool await_ready() noexcept {
+      return pop();
+    }
+
+    bool await_suspend(coroutine_handle<> handle) noexcept {
+      handle_ = handle;
+      events_ = events::current();
+      return wait();
+    }
+
+    std::optional<T> await_resume() noexcept {
+      if (!value_) {
+        pop();
+      }
+      return std::move(value_);
+    }
+
+    // Resumes the consumer unless the value that woke it up was already received.
+    void operator()() noexcept override {
+      if (pop() || !wait()) {
+        handle_.resume();
+      }
+    }
+
+  private:
+    friend class channel;
+
+    // Receives the next value. Returns false if the channel is empty and not closed.
+    bool pop() noexcept {
+      const auto closed = channel_.closed();
+      if ((value_ = channel_.ring_.try_pop())) {
+        channel_.wake_producers();
+        return true;
+      }
+      return closed;
+    }
+
+    // Registers the receiver as waiting and checks if a producer sent a value or closed the channel in the meantime.
+    // Returns false if the receiver does not have to wait.
+    bool wait() noexcept {
+      channel_.consumer_.store(this, std::memory_order_seq_cst);
+      if (!channel_.ring_.empty() || channel_.closed()) {
+        // Do not wait unless a producer already took the receiver to wake it up.
+        return !channel_.consumer_.exchange(nullptr, std::memory_order_acq_rel);
+      }
+      return true;
+    }
+
+    // Resumes the receiver on its events queue.
+    void wake() noexcept {
+      if (events_) {
+        events_->post(*this);
+      } else {
+        (*this)();
+      }
+    }
+
+    channel& channel_;
+    std::optional<T> value_;
+    coroutine_handle<> handle_ = nullptr;
+    events* events_ = nullptr;
+  };
+
+private:
+  using ring_type =
+    std::conditional_t<Producers == producers::single, detail::spsc_ring<T>, detail::mpsc_ring<T>>;
+
+  // Wakes up the consumer if it waits for a value.
+  void wake_consumer() noexcept {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (consumer_.load(std::memory_order_relaxed)) {
+      if (const auto consumer = consumer_.exchange(nullptr, std::memory_order_acq_rel)) {
+        consumer->wake();
+      }
+    }
+  }
+
+  // Wakes up all producers that wait for space.
+  void wake_producers() noexcept {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (producers_.load(std::memory_order_relaxed)) {
+      auto producer = producers_.exchange(nullptr, std::memory_order_acq_rel);
+      while (producer) {
+        const auto next = producer->next_;
+        producer->wake();
+        producer = next;
+      }
+    }
+  }
+
+  ring_type ring_;
+  std::atomic<bool> closed_ = false;
+  std::atomic<receiver*> consumer_ = nullptr;
+  std::atomic<sender*> producers_ = nullptr;
+};
+
+// clang-format off
+
+template <typename T, producers Producers>
+local_async_generator<T> channel<T, Producers>::values() noexcept {
+  while (auto value = co_await recv()) {
+    co_yield *value;
+  }
+}
+
+// clang-format on
+
+}  // namespace coronet
@@ -6,6 +6,7 @@ namespace coronet {
 enum class errc {
   eof = -1,
   cancelled = -2,
+  closed = -3,
 };
 
 const std::error_category& error_category() noexcept;
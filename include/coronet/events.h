@@ -1,22 +1,200 @@
 #pragma once
 #include <coronet/async.h>
+#include <coronet/cancellation.h>
 #include <coronet/error.h>
 #include <coronet/handle.h>
+#include <coronet/timer.h>
+#include <coronet/work.h>
+#include <chrono>
+#include <utility>
+#include <cstddef>
 
 namespace coronet {
 
+class delay;
+class handoff;
+
+// Settings that trade processor time for latency in events::run.
+struct policy {
+  // Number of events that are handled in a single batch.
+  // The batch size doubles up to batch_max whenever a batch is full.
+  std::size_t batch = 32;
+  std::size_t batch_max = 1024;
+
+  // Time to keep polling for events without blocking after the last batch of events.
+  std::chrono::microseconds spin = {};
+
+  // Time the kernel busy polls network device queues before it puts the thread to sleep.
+  // Supported by the epoll (Linux 6.9) and io_uring (Linux 6.9) backends. Ignored by older kernels.
+  std::chrono::microseconds busy_poll = {};
+};
+
 class events final : public handle<events> {
 public:
+  // Backend specific events queue state.
+  class state;
+
   using handle::handle;
 
+  events() noexcept = default;
+
+  events(events&& other) noexcept : handle(std::move(other)), state_(std::exchange(other.state_, nullptr)) {
+  }
+
+  events& operator=(events&& other) noexcept {
+    handle::operator=(std::move(other));
+    std::swap(state_, other.state_);
+    return *this;
+  }
+
+  ~events() override;
+
   // Creates events queue that processes max. size number of events at once.
   std::error_code create() noexcept;
 
   // Runs events queue on the given processor.
-  std::error_code run(int processor = -1);
+  // Pins the calling thread to the processor unless it is negative.
+  std::error_code run(int processor = -1, const policy& policy = {});
+
+  // Makes run return after handling the current batch of events.
+  // Can be called from any thread and from signal handlers.
+  void stop() noexcept;
+
+  // Arms the timer to expire after the given duration. Rearms the timer if it is already armed.
+  // Timers must be armed and cancelled on the thread that runs the events queue.
+  void start(timer& timer, std::chrono::milliseconds duration) noexcept;
+
+  // Disarms the timer.
+  void cancel(timer& timer) noexcept;
+
+  // Returns awaitable that resumes the coroutine after the given duration.
+  // The awaitable returns errc::cancelled when the token is cancelled before the duration passes.
+  delay sleep_for(std::chrono::milliseconds duration, cancellation_token token = {}) noexcept;
+
+  // Calls the work item on the thread that runs the events queue.
+  // Can be called from any thread and from signal handlers.
+  // Work items that are posted before the events queue wakes up share a single wakeup.
+  void post(work& work) noexcept;
+
+  // Resumes the coroutine on the thread that runs the events queue.
+  // Can be called from any thread.
+  void post(coroutine_handle<> handle) noexcept;
+
+  // Returns awaitable that resumes the coroutine on the thread that runs the events queue.
+  handoff schedule() noexcept;
 
   // Closes events queue.
   std::error_code close() noexcept;
+
+  // Returns backend specific events queue state.
+  state* data() const noexcept {
+    return state_;
+  }
+
+  // Returns the events queue that runs on the current thread or nullptr.
+  static events* current() noexcept {
+    return current_;
+  }
+
+private:
+  // Work item that resumes a posted coroutine and deletes itself.
+  class resumption final : public work {
+  public:
+    explicit resumption(coroutine_handle<> handle) noexcept : handle_(handle) {
+    }
+
+    void operator()() noexcept override {
+      const auto handle = handle_;
+      delete this;
+      handle.resume();
+    }
+
+  private:
+    coroutine_handle<> handle_;
+  };
+
+  state* state_ = nullptr;
+
+  static inline thread_local events* current_ = nullptr;
+};
+
+class delay final : public timer, public cancellation_callback {
+public:
+  delay(events& events, std::chrono::milliseconds duration, cancellation_token token) noexcept :
+    events_(events), duration_(duration), token_(token) {
+  }
+
+  ~delay() {
+    events_.cancel(*this);
+  }
+
+  bool await_ready() noexcept {
+    return duration_.count() <= 0 || token_.cancelled();
+  }
+
+  void await_suspend(coroutine_handle<> handle) noexcept {
+    handle_ = handle;
+    token_.attach(*this);
+    events_.start(*this, duration_);
+  }
+
+  std::error_code await_resume() noexcept {
+    if (token_.cancelled()) {
+      return errc::cancelled;
+    }
+    return {};
+  }
+
+  // Called when the timer expires or the token is cancelled.
+  void operator()() noexcept override {
+    events_.cancel(*this);
+    cancellation_callback::reset();
+    std::exchange(handle_, nullptr).resume();
+  }
+
+private:
+  events& events_;
+  std::chrono::milliseconds duration_;
+  cancellation_token token_;
+  coroutine_handle<> handle_ = nullptr;
 };
 
+class handoff final : public work {
+public:
+  explicit handoff(events& events) noexcept : events_(events) {
+  }
+
+  constexpr bool await_ready() noexcept {
+    return false;
+  }
+
+  void await_suspend(coroutine_handle<> handle) noexcept {
+    handle_ = handle;
+    events_.post(*this);
+  }
+
+  constexpr void await_resume() noexcept {
+  }
+
+  void operator()() noexcept override {
+    handle_.resume();
+  }
+
+private:
+  events& events_;
+  coroutine_handle<> handle_ = nullptr;
+};
+
+inline delay events::sleep_for(std::chrono::milliseconds duration, cancellation_token token) noexcept {
+  return { *this, duration, token };
+}
+
+inline void events::post(coroutine_handle<> handle) noexcept {
+  post(*new resumption(handle));
+}
+
+inline handoff events::schedule() noexcept {
+  return handoff(*this);
+}
+
 }  // namespace coronet
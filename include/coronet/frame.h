@@ -0,0 +1,155 @@
+#pragma once
+#include <memory>
+#include <new>
+#include <cstddef>
+#include <cstdint>
+
+namespace coronet {
+
+// Allocates coroutine frames.
+// Coroutines that take std::allocator_arg and a frame allocator as their first arguments (after the object
+// for member functions) allocate their frame with it. The allocator must outlive the coroutine and return
+// memory that is aligned to alignof(std::max_align_t) or nullptr to fall back to the frame pool.
+class frame_allocator {
+public:
+  virtual void* allocate(std::size_t size) noexcept = 0;
+  virtual void deallocate(void* data, std::size_t size) noexcept = 0;
+
+protected:
+  ~frame_allocator() = default;
+};
+
+// Size class freelist that reuses coroutine frames on the current thread without locking.
+// Frames that are destroyed on a different thread, or after the pool of their thread was destroyed,
+// are released with ::operator delete.
+class frame_pool final {
+public:
+  // Frames are rounded up to multiples of the granularity.
+  // Frames larger than granularity * classes bytes are not cached.
+  constexpr static std::size_t granularity = 64;
+  constexpr static std::size_t classes = 32;
+
+  // Maximum number of cached frames per size class.
+  constexpr static std::size_t capacity = 1024;
+
+  frame_pool() noexcept = default;
+
+  frame_pool(frame_pool&& other) = delete;
+  frame_pool& operator=(frame_pool&& other) = delete;
+
+  ~frame_pool() {
+    destroyed_ = true;
+    for (auto& head : heads_) {
+      while (const auto block = head) {
+        head = block->next;
+        ::operator delete(block);
+      }
+    }
+  }
+
+  // Returns the frame pool of the current thread or nullptr during thread_local and static destruction.
+  static frame_pool* local() noexcept {
+    if (destroyed_) {
+      return nullptr;
+    }
+    thread_local frame_pool pool;
+    return &pool;
+  }
+
+  void* allocate(std::size_t size) {
+    const auto index = (size + granularity - 1) / granularity - 1;
+    if (index >= classes) {
+      return ::operator new(size);
+    }
+    if (const auto block = heads_[index]) {
+      heads_[index] = block->next;
+      counts_[index]--;
+      return block;
+    }
+    return ::operator new((index + 1) * granularity);
+  }
+
+  void deallocate(void* data, std::size_t size) noexcept {
+    const auto index = (size + granularity - 1) / granularity - 1;
+    if (index >= classes || counts_[index] == capacity) {
+      ::operator delete(data);
+      return;
+    }
+    const auto block = static_cast<struct block*>(data);
+    block->next = heads_[index];
+    heads_[index] = block;
+    counts_[index]++;
+  }
+
+private:
+  struct block {
+    block* next;
+  };
+
+  block* heads_[classes] = {};
+  std::size_t counts_[classes] = {};
+
+  // Trivially destructible, so that it can be read after the pool of the thread was destroyed.
+  static inline thread_local bool destroyed_ = false;
+};
+
+// Base class of promise types that allocates coroutine frames from the frame pool of the current thread
+// or from the frame allocator that is passed to the coroutine.
+class frame {
+public:
+  static void* operator new(std::size_t size) {
+    return allocate(size, nullptr);
+  }
+
+  template <typename... Args>
+  static void* operator new(std::size_t size, std::allocator_arg_t, frame_allocator& allocator, Args&...) {
+    return allocate(size, &allocator);
+  }
+
+  template <typename Class, typename... Args>
+  static void* operator new(std::size_t size, Class&, std::allocator_arg_t, frame_allocator& allocator, Args&...) {
+    return allocate(size, &allocator);
+  }
+
+  static void operator delete(void* data, std::size_t size) noexcept {
+    const auto block = static_cast<char*>(data) - header;
+    const auto owner = *reinterpret_cast<std::uintptr_t*>(block);
+    if (owner & pooled) {
+      const auto pool = frame_pool::local();
+      if (reinterpret_cast<std::uintptr_t>(pool) == (owner & ~pooled)) {
+        pool->deallocate(block, size + header);
+      } else {
+        ::operator delete(block);
+      }
+    } else if (owner) {
+      reinterpret_cast<frame_allocator*>(owner)->deallocate(block, size + header);
+    } else {
+      ::operator delete(block);
+    }
+  }
+
+private:
+  // Every frame is preceded by a header that stores its owner. The owner is the frame allocator, the address of
+  // the frame pool with the lowest bit set, or zero for frames that were allocated with ::operator new.
+  constexpr static std::size_t header = alignof(std::max_align_t);
+  constexpr static std::uintptr_t pooled = 1;
+
+  // Frame allocators that return nullptr fall back to the frame pool.
+  static void* allocate(std::size_t size, frame_allocator* allocator) {
+    auto owner = reinterpret_cast<std::uintptr_t>(allocator);
+    auto block = allocator ? allocator->allocate(size + header) : nullptr;
+    if (!block) {
+      if (const auto pool = frame_pool::local()) {
+        owner = reinterpret_cast<std::uintptr_t>(pool) | pooled;
+        block = pool->allocate(size + header);
+      } else {
+        owner = 0;
+        block = ::operator new(size + header);
+      }
+    }
+    *static_cast<std::uintptr_t*>(block) = owner;
+    return static_cast<char*>(block) + header;
+  }
+};
+
+}  // namespace coronet
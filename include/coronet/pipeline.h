@@ -0,0 +1,378 @@
+#pragma once
+#include <coronet/async.h>
+#include <iterator>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <cstddef>
+
+namespace coronet {
+namespace detail {
+
+// Stage that passes the result of the function to the next stage.
+template <typename F>
+class transform_stage final {
+public:
+  template <typename T>
+  using output_type = std::decay_t<std::invoke_result_t<F&, T&&>>;
+
+  explicit transform_stage(F function) noexcept : function_(std::move(function)) {
+  }
+
+  template <typename T>
+  transform_stage bind() && noexcept {
+    return std::move(*this);
+  }
+
+  template <typename T, typename Next>
+  bool push(T&& value, Next& next) {
+    return next(function_(std::forward<T>(value)));
+  }
+
+  template <typename Next>
+  constexpr bool flush(Next& next) noexcept {
+    return true;
+  }
+
+private:
+  F function_;
+};
+
+// Stage that passes values that satisfy the predicate to the next stage.
+template <typename F>
+class filter_stage final {
+public:
+  template <typename T>
+  using output_type = T;
+
+  explicit filter_stage(F predicate) noexcept : predicate_(std::move(predicate)) {
+  }
+
+  template <typename T>
+  filter_stage bind() && noexcept {
+    return std::move(*this);
+  }
+
+  template <typename T, typename Next>
+  bool push(T&& value, Next& next) {
+    if (!predicate_(std::as_const(value))) {
+      return true;
+    }
+    return next(std::forward<T>(value));
+  }
+
+  template <typename Next>
+  constexpr bool flush(Next& next) noexcept {
+    return true;
+  }
+
+private:
+  F predicate_;
+};
+
+// Stage that passes values to the next stage until the first value that does not satisfy the predicate.
+template <typename F>
+class take_while_stage final {
+public:
+  template <typename T>
+  using output_type = T;
+
+  explicit take_while_stage(F predicate) noexcept : predicate_(std::move(predicate)) {
+  }
+
+  template <typename T>
+  take_while_stage bind() && noexcept {
+    return std::move(*this);
+  }
+
+  template <typename T, typename Next>
+  bool push(T&& value, Next& next) {
+    if (stopped_ || !predicate_(std::as_const(value))) {
+      stopped_ = true;
+      return false;
+    }
+    return next(std::forward<T>(value));
+  }
+
+  template <typename Next>
+  constexpr bool flush(Next& next) noexcept {
+    return true;
+  }
+
+private:
+  F predicate_;
+  bool stopped_ = false;
+};
+
+// Stage that passes vectors of up to size values to the next stage.
+template <typename T>
+class chunk_stage final {
+public:
+  explicit chunk_stage(std::size_t size) : size_(size > 0 ? size : 1) {
+    values_.reserve(size_);
+  }
+
+  template <typename Next>
+  bool push(T value, Next& next) {
+    values_.push_back(std::move(value));
+    if (values_.size() < size_) {
+      return true;
+    }
+    return flush(next);
+  }
+
+  // Passes the remaining values to the next stage.
+  template <typename Next>
+  bool flush(Next& next) {
+    if (values_.empty()) {
+      return true;
+    }
+    std::vector<T> values;
+    values.reserve(size_);
+    values.swap(values_);
+    return next(std::move(values));
+  }
+
+private:
+  std::size_t size_;
+  std::vector<T> values_;
+};
+
+// Chunk stage that does not know the value type yet.
+class chunk_descriptor final {
+public:
+  template <typename T>
+  using output_type = std::vector<T>;
+
+  explicit chunk_descriptor(std::size_t size) noexcept : size_(size) {
+  }
+
+  template <typename T>
+  chunk_stage<T> bind() && {
+    return chunk_stage<T>(size_);
+  }
+
+private:
+  std::size_t size_;
+};
+
+// Stage that passes the elements of ranges to the next stage.
+class flatten_stage final {
+public:
+  // Passes more than one value to the next stage for a single value.
+  constexpr static bool expands = true;
+
+  template <typename T>
+  using output_type = std::decay_t<decltype(*std::begin(std::declval<T&>()))>;
+
+  template <typename T>
+  flatten_stage bind() && noexcept {
+    return *this;
+  }
+
+  // Elements of ranges that belong to the generator are copied, elements of ranges from earlier stages are moved.
+  template <typename T, typename Next>
+  bool push(T&& range, Next& next) {
+    for (auto& value : range) {
+      if constexpr (std::is_lvalue_reference_v<T>) {
+        if (!next(value)) {
+          return false;
+        }
+      } else {
+        if (!next(std::move(value))) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  template <typename Next>
+  constexpr bool flush(Next& next) noexcept {
+    return true;
+  }
+};
+
+// Returns true if a stage passes more than one value to the next stage for a single value.
+template <typename Stage, typename = void>
+struct expands : std::false_type {};
+
+template <typename Stage>
+struct expands<Stage, std::void_t<decltype(Stage::expands)>> : std::bool_constant<Stage::expands> {};
+
+// Holds the value that the stages produced for a single value of the generator.
+template <typename T>
+class value_buffer final {
+public:
+  void push_back(T value) noexcept {
+    value_.emplace(std::move(value));
+  }
+
+  T* begin() noexcept {
+    return value_ ? &*value_ : nullptr;
+  }
+
+  T* end() noexcept {
+    return value_ ? &*value_ + 1 : nullptr;
+  }
+
+  void clear() noexcept {
+    value_.reset();
+  }
+
+private:
+  std::optional<T> value_;
+};
+
+// Passes the value through the stages starting with stage I and appends the results to the buffer.
+// Returns false when a stage does not accept more values.
+template <std::size_t I, typename Stages, typename Buffer, typename T>
+bool push_stages(Stages& stages, Buffer& buffer, T&& value) {
+  if constexpr (I == std::tuple_size_v<Stages>) {
+    buffer.push_back(std::forward<T>(value));
+    return true;
+  } else {
+    auto next = [&stages, &buffer](auto&& value) {
+      return push_stages<I + 1>(stages, buffer, std::forward<decltype(value)>(value));
+    };
+    return std::get<I>(stages).push(std::forward<T>(value), next);
+  }
+}
+
+// Passes the values that the stages starting with stage I hold back to the end of the pipeline.
+template <std::size_t I, typename Stages, typename Buffer>
+void flush_stages(Stages& stages, Buffer& buffer) {
+  if constexpr (I < std::tuple_size_v<Stages>) {
+    auto next = [&stages, &buffer](auto&& value) {
+      return push_stages<I + 1>(stages, buffer, std::forward<decltype(value)>(value));
+    };
+    std::get<I>(stages).flush(next);
+    flush_stages<I + 1>(stages, buffer);
+  }
+}
+
+// clang-format off
+
+// Runs the generator and all stages in a single coroutine.
+// Values of the generator are passed to the first stage as lvalues, so stages copy what they keep and the
+// producer can keep using the object that it yielded.
+template <typename T, typename Generator, typename... Stages>
+local_async_generator<T> fuse(Generator generator, std::tuple<Stages...> stages) {
+  std::conditional_t<(expands<Stages>::value || ...), std::vector<T>, value_buffer<T>> buffer;
+  auto it = co_await generator.begin();
+  while (it != generator.end()) {
+    const auto more = push_stages<0>(stages, buffer, *it);
+    for (auto& value : buffer) {
+      co_yield value;
+    }
+    buffer.clear();
+    if (!more) {
+      break;
+    }
+    co_await ++it;
+  }
+  std::vector<T> rest;
+  flush_stages<0>(stages, rest);
+  for (auto& value : rest) {
+    co_yield value;
+  }
+}
+
+// clang-format on
+
+template <typename Generator>
+using generator_value_type = std::remove_cv_t<typename Generator::iterator::value_type>;
+
+}  // namespace detail
+
+// Generator with stages that run in the coroutine of the pipeline instead of one coroutine per stage.
+// Stages are added with operator| and the coroutine is created when the pipeline is iterated or converted to a
+// local_async_generator. Values that stages hold back (for example the last incomplete chunk) are passed on
+// when the generator completes.
+template <typename T, typename Generator, typename... Stages>
+class pipeline final {
+public:
+  using value_type = T;
+  using generator_type = local_async_generator<T>;
+
+  pipeline(Generator generator, std::tuple<Stages...> stages) noexcept :
+    generator_(std::move(generator)), stages_(std::move(stages)) {
+  }
+
+  // Returns pipeline with the stage added to the end.
+  template <typename Descriptor>
+  auto operator|(Descriptor descriptor) && {
+    using stage_type = decltype(std::move(descriptor).template bind<T>());
+    using output_type = typename Descriptor::template output_type<T>;
+    return pipeline<output_type, Generator, Stages..., stage_type>(
+      std::move(generator_),
+      std::tuple_cat(std::move(stages_), std::make_tuple(std::move(descriptor).template bind<T>())));
+  }
+
+  // Creates the coroutine that runs the generator and the stages.
+  operator generator_type() && {
+    return detail::fuse<T>(std::move(generator_), std::move(stages_));
+  }
+
+  auto begin() {
+    fused_.emplace(detail::fuse<T>(std::move(generator_), std::move(stages_)));
+    return fused_->begin();
+  }
+
+  auto end() noexcept {
+    return fused_->end();
+  }
+
+private:
+  Generator generator_;
+  std::tuple<Stages...> stages_;
+  std::optional<generator_type> fused_;
+};
+
+// Passes the result of the function for every value.
+template <typename F>
+detail::transform_stage<F> transform(F function) noexcept {
+  return detail::transform_stage<F>(std::move(function));
+}
+
+// Passes the values that satisfy the predicate.
+template <typename F>
+detail::filter_stage<F> filter(F predicate) noexcept {
+  return detail::filter_stage<F>(std::move(predicate));
+}
+
+// Passes values until the first value that does not satisfy the predicate and stops the generator.
+template <typename F>
+detail::take_while_stage<F> take_while(F predicate) noexcept {
+  return detail::take_while_stage<F>(std::move(predicate));
+}
+
+// Passes vectors of size values. The last vector can be smaller.
+// Values are held while the generator produces the next ones. Values that refer to memory that the generator
+// reuses, for example the views of socket::recv, are overwritten and must be transformed into owning values first.
+inline detail::chunk_descriptor chunk(std::size_t size) noexcept {
+  return detail::chunk_descriptor(size);
+}
+
+// Passes the elements of every value.
+inline detail::flatten_stage flatten() noexcept {
+  return {};
+}
+
+// Creates pipeline with the generator as source.
+template <typename U, typename Descriptor>
+auto operator|(async_generator<U> generator, Descriptor descriptor) {
+  using T = detail::generator_value_type<async_generator<U>>;
+  return pipeline<T, async_generator<U>>(std::move(generator), {}) | std::move(descriptor);
+}
+
+// Creates pipeline with the generator as source.
+template <typename U, typename Descriptor>
+auto operator|(local_async_generator<U> generator, Descriptor descriptor) {
+  using T = detail::generator_value_type<local_async_generator<U>>;
+  return pipeline<T, local_async_generator<U>>(std::move(generator), {}) | std::move(descriptor);
+}
+
+}  // namespace coronet
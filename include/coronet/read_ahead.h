@@ -0,0 +1,246 @@
+#pragma once
+#include <coronet/async.h>
+#include <coronet/events.h>
+#include <coronet/work.h>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <cstddef>
+
+namespace coronet {
+namespace detail {
+
+// Coroutine that reads items from a generator into a ring buffer ahead of the consumer.
+// The producer is suspended when the ring buffer is full. When the consumer takes an item or waits for one, the
+// producer is posted to the events queue of the current thread, so it keeps reading while the consumer is suspended.
+// Without an events queue, the producer only runs while the consumer waits for an item.
+template <typename T>
+class read_ahead_buffer final {
+public:
+  struct promise_type final : frame, work {
+    // Stores the item and hands it to the consumer if it waits for one.
+    struct yield_operation final {
+      constexpr bool await_ready() noexcept {
+        return false;
+      }
+
+      coroutine_handle<> await_suspend(coroutine_handle<promise_type> handle) noexcept {
+        auto& promise = handle.promise();
+        if (promise.detached_) {
+          handle.destroy();
+          return noop_coroutine();
+        }
+        promise.producer_ = handle;
+        if (const auto consumer = std::exchange(promise.consumer_, nullptr)) {
+          if (promise.size_ < promise.capacity_) {
+            promise.schedule();
+          }
+          return consumer;
+        }
+        if (promise.size_ < promise.capacity_) {
+          promise.producer_ = nullptr;
+          return handle;
+        }
+        return noop_coroutine();
+      }
+
+      constexpr void await_resume() noexcept {
+      }
+    };
+
+    // Marks the buffer as done or destroys the coroutine if the consumer is gone.
+    struct final_operation final {
+      constexpr bool await_ready() noexcept {
+        return false;
+      }
+
+      coroutine_handle<> await_suspend(coroutine_handle<promise_type> handle) noexcept {
+        auto& promise = handle.promise();
+        if (promise.detached_) {
+          handle.destroy();
+          return noop_coroutine();
+        }
+        promise.done_ = true;
+        if (const auto consumer = std::exchange(promise.consumer_, nullptr)) {
+          return consumer;
+        }
+        return noop_coroutine();
+      }
+
+      constexpr void await_resume() noexcept {
+      }
+    };
+
+    read_ahead_buffer get_return_object() noexcept {
+      return { *this };
+    }
+
+    constexpr auto initial_suspend() noexcept {
+      return suspend_always{};
+    }
+
+    auto final_suspend() noexcept {
+      return final_operation{};
+    }
+
+    yield_operation yield_value(T&& value) noexcept {
+      items_[(head_ + size_) % capacity_].emplace(std::move(value));
+      size_++;
+      return {};
+    }
+
+    constexpr void return_void() noexcept {
+    }
+
+    void unhandled_exception() noexcept {
+      std::abort();
+    }
+
+    // Resumes the posted producer or destroys it if the consumer is gone.
+    void operator()() noexcept override {
+      posted_ = false;
+      if (detached_) {
+        coroutine_handle<promise_type>::from_promise(*this).destroy();
+        return;
+      }
+      std::exchange(producer_, nullptr).resume();
+    }
+
+    // Posts the suspended producer to the events queue of the current thread.
+    void schedule() noexcept {
+      if (const auto events = events::current()) {
+        posted_ = true;
+        events->post(*this);
+      }
+    }
+
+    std::unique_ptr<std::optional<T>[]> items_;
+    std::size_t capacity_ = 0;
+    std::size_t head_ = 0;
+    std::size_t size_ = 0;
+    coroutine_handle<> consumer_ = nullptr;
+    coroutine_handle<> producer_ = nullptr;
+    bool posted_ = false;
+    bool detached_ = false;
+    bool done_ = false;
+  };
+
+  using handle_type = coroutine_handle<promise_type>;
+
+  // Waits for the next item. Returns std::nullopt after the last item.
+  class next_operation final {
+  public:
+    explicit next_operation(promise_type& promise) noexcept : promise_(promise) {
+    }
+
+    bool await_ready() noexcept {
+      return promise_.size_ || promise_.done_;
+    }
+
+    coroutine_handle<> await_suspend(coroutine_handle<> handle) noexcept {
+      promise_.consumer_ = handle;
+      if (promise_.producer_ && !promise_.posted_) {
+        return std::exchange(promise_.producer_, nullptr);
+      }
+      return noop_coroutine();
+    }
+
+    std::optional<T> await_resume() noexcept {
+      if (!promise_.size_) {
+        return std::nullopt;
+      }
+      auto& item = promise_.items_[promise_.head_];
+      std::optional<T> value(std::move(item));
+      item.reset();
+      promise_.head_ = (promise_.head_ + 1) % promise_.capacity_;
+      promise_.size_--;
+      if (promise_.producer_ && !promise_.posted_) {
+        promise_.schedule();
+      }
+      return value;
+    }
+
+  private:
+    promise_type& promise_;
+  };
+
+  read_ahead_buffer(promise_type& promise) noexcept : handle_(handle_type::from_promise(promise)) {
+  }
+
+  read_ahead_buffer(read_ahead_buffer&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {
+  }
+
+  read_ahead_buffer& operator=(read_ahead_buffer&& other) = delete;
+
+  // Destroys the producer if it is suspended in the buffer.
+  // Otherwise the producer destroys itself when the generator yields the next item or completes.
+  ~read_ahead_buffer() {
+    if (!handle_) {
+      return;
+    }
+    auto& promise = handle_.promise();
+    if (promise.done_ || (promise.producer_ && !promise.posted_)) {
+      handle_.destroy();
+    } else {
+      promise.detached_ = true;
+    }
+  }
+
+  // Allocates the ring buffer and starts the producer.
+  void start(std::size_t capacity) {
+    auto& promise = handle_.promise();
+    promise.capacity_ = capacity > 0 ? capacity : 1;
+    promise.items_ = std::make_unique<std::optional<T>[]>(promise.capacity_);
+    handle_.resume();
+  }
+
+  // Returns awaitable that waits for the next item.
+  next_operation next() noexcept {
+    return next_operation(handle_.promise());
+  }
+
+private:
+  handle_type handle_ = nullptr;
+};
+
+// clang-format off
+
+template <typename T, typename Generator>
+read_ahead_buffer<T> fill(Generator generator) {
+  auto it = co_await generator.begin();
+  while (it != generator.end()) {
+    co_yield T(std::move(*it));
+    co_await ++it;
+  }
+}
+
+template <typename T, typename Generator>
+local_async_generator<T> read_ahead(Generator generator, std::size_t size) {
+  auto buffer = fill<T>(std::move(generator));
+  buffer.start(size);
+  while (auto value = co_await buffer.next()) {
+    co_yield *value;
+  }
+}
+
+// clang-format on
+
+}  // namespace detail
+
+// Reads up to size items from the generator ahead of the consumer, so that the generator keeps waiting for the
+// next item while the consumer processes the previous one. Items are moved into a ring buffer and must not refer
+// to memory that the generator reuses for the next item. The generator must produce items on the thread of the
+// consumer. If the consumer stops early, the generator must still yield or complete (for example because its
+// cancellation token was cancelled) before the resources that it uses are destroyed.
+template <typename T>
+local_async_generator<T> read_ahead(async_generator<T> generator, std::size_t size) {
+  return detail::read_ahead<T>(std::move(generator), size);
+}
+
+// Reads up to size items from the generator ahead of the consumer.
+template <typename T>
+local_async_generator<T> read_ahead(local_async_generator<T> generator, std::size_t size) {
+  return detail::read_ahead<T>(std::move(generator), size);
+}
+
+}  // namespace coronet
@@ -0,0 +1,130 @@
+#pragma once
+#include <coronet/async.h>
+#include <coronet/cancellation.h>
+#include <coronet/events.h>
+#include <coronet/socket.h>
+#include <coronet/timer.h>
+#include <algorithm>
+#include <chrono>
+#include <system_error>
+#include <cstdint>
+
+namespace coronet {
+
+// Number of bytes that relay moved in each direction and the first error.
+struct relay_result {
+  std::uint64_t sent = 0;
+  std::uint64_t received = 0;
+  std::error_code ec;
+};
+
+namespace detail {
+
+// Cancels the source when the token that the callback is attached to is cancelled.
+class cancellation_link final : public cancellation_callback {
+public:
+  explicit cancellation_link(cancellation_source& source) noexcept : source_(source) {
+  }
+
+  void operator()() noexcept override {
+    source_.cancel();
+  }
+
+private:
+  cancellation_source& source_;
+};
+
+// Stops the relay when the timeout passes without moving data in either direction.
+// Checks the byte counts four times per timeout, so data in one direction keeps the other direction alive.
+class relay_watchdog final : public timer {
+public:
+  relay_watchdog(
+    events& events, relay_result& result, std::chrono::milliseconds timeout, cancellation_source& source) noexcept :
+    events_(events), result_(result), timeout_(timeout), interval_(std::max(timeout / 4, std::chrono::milliseconds(1))),
+    source_(source) {
+  }
+
+  void start() noexcept {
+    events_.start(*this, interval_);
+  }
+
+  void stop() noexcept {
+    if (armed()) {
+      events_.cancel(*this);
+    }
+  }
+
+  void operator()() noexcept override {
+    const auto moved = result_.sent + result_.received;
+    if (moved != moved_) {
+      moved_ = moved;
+      idle_ = {};
+    } else {
+      idle_ += interval_;
+      if (idle_ >= timeout_) {
+        if (!result_.ec) {
+          result_.ec = errc::cancelled;
+        }
+        source_.cancel();
+        return;
+      }
+    }
+    events_.start(*this, interval_);
+  }
+
+private:
+  events& events_;
+  relay_result& result_;
+  std::chrono::milliseconds timeout_;
+  std::chrono::milliseconds interval_;
+  std::chrono::milliseconds idle_{};
+  std::uint64_t moved_ = 0;
+  cancellation_source& source_;
+};
+
+// clang-format off
+
+// Moves data in one direction and stops the other direction on errors.
+inline lazy<std::error_code> relay(
+  socket& from, socket& to, std::uint64_t& count, std::error_code& error, cancellation_source& source) noexcept {
+  const auto ec = co_await from.splice(to, count, {}, source.token());
+  if (ec && !error) {
+    error = ec;
+    source.cancel();
+  }
+  co_return ec;
+}
+
+// clang-format on
+
+}  // namespace detail
+
+// clang-format off
+
+// Moves data in both directions between the sockets with socket::splice until both directions reached the end of
+// the stream. The end of the stream in one direction is forwarded as a half-close, so the other direction keeps
+// running. The first error stops both directions and is returned in the result.
+// Returns errc::cancelled when a non-zero timeout passes without moving data in either direction or the token is
+// cancelled. The timeout is checked on the events queue, which must be the queue that runs the coroutine.
+inline async<relay_result> relay(
+  events& events, socket& a, socket& b, std::chrono::milliseconds timeout = {}, cancellation_token token = {}) noexcept {
+  relay_result result;
+  cancellation_source source;
+  detail::cancellation_link link(source);
+  if (!token.attach(link)) {
+    co_return relay_result{ 0, 0, errc::cancelled };
+  }
+  detail::relay_watchdog watchdog(events, result, timeout, source);
+  if (timeout.count() > 0) {
+    watchdog.start();
+  }
+  co_await when_all(
+    detail::relay(a, b, result.sent, result.ec, source),
+    detail::relay(b, a, result.received, result.ec, source));
+  watchdog.stop();
+  co_return result;
+}
+
+// clang-format on
+
+}  // namespace coronet
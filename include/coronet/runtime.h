@@ -0,0 +1,57 @@
+#pragma once
+#include <coronet/events.h>
+#include <vector>
+#include <cstddef>
+
+namespace coronet {
+
+// Thread-per-core runtime that runs one events queue per processor.
+class runtime final {
+public:
+  runtime() noexcept = default;
+
+  runtime(runtime&& other) = delete;
+  runtime& operator=(runtime&& other) = delete;
+
+  ~runtime() = default;
+
+  // Creates the given number of events queues or one events queue per available processor if size is 0.
+  std::error_code create(std::size_t size = 0) noexcept;
+
+  // Runs every events queue on its own thread pinned to an available processor.
+  // The first events queue runs on the calling thread. All events queues are stopped when one of them returns.
+  // Returns the first error reported by an events queue.
+  std::error_code run(const policy& policy = {});
+
+  // Stops all events queues.
+  // Can be called from any thread and from signal handlers.
+  void stop() noexcept;
+
+  // Returns the number of events queues.
+  std::size_t size() const noexcept {
+    return events_.size();
+  }
+
+  // Returns the processor that the events queue with the given index runs on.
+  int processor(std::size_t index) const noexcept {
+    return processors_[index % processors_.size()];
+  }
+
+  events& operator[](std::size_t index) noexcept {
+    return events_[index];
+  }
+
+  auto begin() noexcept {
+    return events_.begin();
+  }
+
+  auto end() noexcept {
+    return events_.end();
+  }
+
+private:
+  std::vector<events> events_;
+  std::vector<int> processors_;
+};
+
+}  // namespace coronet
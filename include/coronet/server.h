@@ -1,6 +1,7 @@
 #pragma once
 #include <coronet/socket.h>
 #include <string>
+#include <vector>
 
 namespace coronet {
 
@@ -9,11 +10,26 @@ public:
   using socket::socket;
 
   // Creates and binds server socket.
-  std::error_code create(const std::string& host, const std::string& port, type type) noexcept;
+  // Sets SO_REUSEPORT when reuseport is true, which lets servers on different events queues bind
+  // their own listening socket to the same address and makes the kernel distribute connections between them.
+  std::error_code create(const std::string& host, const std::string& port, type type, bool reuseport = false) noexcept;
+
+  // Creates server that accepts connections from the listening socket of another server.
+  // Lets servers on different events queues share a single listening socket.
+  std::error_code create(const server& other) noexcept;
+
+  // Attaches a reuseport program that hands new connections to the server in the reuseport group
+  // whose events queue runs on the processor that received the connection.
+  // The processors are listed in the order in which the servers in the group were created.
+  // Connections received on other processors are distributed by hash.
+  std::error_code steer(const std::vector<int>& processors) noexcept;
 
   // Accepts client connections.
+  // Accepts all pending connections before waiting for the next readiness notification.
   // Completes range and sets ec_ on error. Ignores connection errors.
-  async_generator<socket> accept(std::size_t backlog = 0) noexcept;
+  // Sets ec_ to errc::cancelled when a non-zero timeout passes without a connection or the token is cancelled.
+  local_async_generator<socket> accept(
+    std::size_t backlog = 0, std::chrono::milliseconds timeout = {}, cancellation_token token = {}) noexcept;
 
   // Stops accepting client connections.
   std::error_code stop() noexcept {
@@ -1,12 +1,22 @@
 #pragma once
 #include <coronet/async.h>
+#include <coronet/cancellation.h>
 #include <coronet/events.h>
 #include <coronet/error.h>
+#include <chrono>
 #include <functional>
+#include <string>
 #include <string_view>
+#include <utility>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
 
 namespace coronet {
 
+// Backend specific socket registration in the events queue.
+class descriptor;
+
 enum class family {
   ipv4,
   ipv6,
@@ -19,31 +29,184 @@ enum class type {
 
 enum class option {
   nodelay,
+  gro,
+};
+
+// Address of a datagram peer.
+class endpoint {
+public:
+  // Maximum size of a socket address.
+  constexpr static std::size_t capacity = 128;
+
+  // Converts host and port to the address of a peer.
+  std::error_code create(const std::string& host, const std::string& port) noexcept;
+
+  // Returns the numeric host of the address or an empty string if the address is not set.
+  std::string host() const;
+
+  // Returns the port of the address or 0 if the address is not set.
+  std::uint16_t port() const noexcept;
+
+  void* data() noexcept {
+    return storage_;
+  }
+
+  const void* data() const noexcept {
+    return storage_;
+  }
+
+  std::size_t size() const noexcept {
+    return size_;
+  }
+
+  // Sets the size of the socket address that was written to data.
+  void resize(std::size_t size) noexcept {
+    size_ = size < capacity ? size : capacity;
+  }
+
+private:
+  alignas(std::max_align_t) unsigned char storage_[capacity] = {};
+  std::size_t size_ = 0;
+};
+
+// Datagram and the address of the peer that sent it or that it is sent to.
+struct datagram {
+  endpoint peer;
+  std::string_view data;
 };
 
 class socket : public handle<socket> {
 public:
+  // Messages smaller than this are copied by send_zerocopy.
+  constexpr static std::size_t zerocopy_threshold = 16 * 1024;
+
   explicit socket(events& events) noexcept : events_(events) {
   }
 
   explicit socket(events& events, handle_type value) noexcept : handle(value), events_(events) {
   }
 
+  socket(socket&& other) noexcept :
+    handle(std::move(other)), ec_(other.ec_), events_(other.events_),
+    descriptor_(std::exchange(other.descriptor_, nullptr)), zerocopy_(other.zerocopy_),
+    zerocopy_id_(other.zerocopy_id_) {
+  }
+
+  socket& operator=(socket&& other) noexcept {
+    if (this != std::addressof(other)) {
+      handle::operator=(std::move(other));
+      ec_ = other.ec_;
+      events_ = other.events_;
+      descriptor_ = std::exchange(other.descriptor_, nullptr);
+      zerocopy_ = other.zerocopy_;
+      zerocopy_id_ = other.zerocopy_id_;
+    }
+    return *this;
+  }
+
   // Creates socket.
   std::error_code create(family family, type type, int protocol = 0) noexcept;
 
   // Sets socket option.
+  // The gro option makes the kernel coalesce received UDP datagrams, which recv_from splits again (Linux only).
   std::error_code set(option option, bool enable) noexcept;
 
+  // Returns the processor that handled the last packet received by the socket or -1 if unknown.
+  int processor() const noexcept;
+
   // Reads data from socket.
   // Completes range on closed connection.
   // Sets ec_ and completes range on error.
-  async_generator<std::string_view> recv(void* data, std::size_t size) noexcept;
+  // Sets ec_ to errc::cancelled when a non-zero timeout passes without receiving data or the token is cancelled.
+  local_async_generator<std::string_view> recv(
+    void* data, std::size_t size, std::chrono::milliseconds timeout = {}, cancellation_token token = {}) noexcept;
+
+  // Reads data from socket into the chain of buffers until no more data is available or all buffers are full.
+  // Yields the received data as a single batch with one view per filled buffer. Empty buffers are skipped.
+  // Completes range on closed connection.
+  // Sets ec_ and completes range on error.
+  // Sets ec_ to errc::cancelled when a non-zero timeout passes without receiving data or the token is cancelled.
+  local_async_generator<const std::vector<std::string_view>&> recv(
+    std::vector<std::string>& buffers, std::chrono::milliseconds timeout = {}, cancellation_token token = {}) noexcept;
 
   // Writes message to the socket.
-  async<std::error_code> send(std::string_view message) noexcept;
+  // Returns errc::cancelled when a non-zero timeout passes without sending data or the token is cancelled.
+  async<std::error_code> send(
+    std::string_view message, std::chrono::milliseconds timeout = {}, cancellation_token token = {}) noexcept;
+
+  // Writes the buffers to the socket in order with vectored writes.
+  // Partial writes resume in the middle of the first buffer that was not written completely.
+  // Returns errc::cancelled when a non-zero timeout passes without sending data or the token is cancelled.
+  async<std::error_code> send(
+    const std::vector<std::string_view>& buffers, std::chrono::milliseconds timeout = {},
+    cancellation_token token = {}) noexcept;
+
+  // Writes message to the socket without copying it into the kernel.
+  // Completes when the kernel no longer uses the message, so that the memory can be reused or released afterwards.
+  // Messages smaller than zerocopy_threshold and sockets or platforms without zero-copy support fall back to send.
+  // Only one zero-copy send can be in progress on a socket.
+  // Returns errc::cancelled when a non-zero timeout passes without sending data or the token is cancelled.
+  // Waiting for the kernel to release the message is not limited by the timeout or the token.
+  async<std::error_code> send_zerocopy(
+    std::string_view message, std::chrono::milliseconds timeout = {}, cancellation_token token = {}) noexcept;
+
+  // Sends size bytes of the file starting at offset without copying them through user space (Linux only).
+  // Regular files are sent from offset. Other files, for example pipes, are read from their current position.
+  // Completes early at the end of the file.
+  // Returns errc::cancelled when a non-zero timeout passes without sending data or the token is cancelled.
+  async<std::error_code> send_file(
+    int file, std::uint64_t offset, std::uint64_t size, std::chrono::milliseconds timeout = {},
+    cancellation_token token = {}) noexcept;
+
+  // Moves data from the socket to the other socket through a pipe without copying it through user space (Linux only).
+  // Reads more data only after the other socket accepted the previous data, so a slow receiver slows down the sender.
+  // Shuts down the sending direction of the other socket and completes when the socket reaches the end of the stream.
+  // Adds the number of moved bytes to count. Must not be used concurrently with recv on the socket or send on the
+  // other socket.
+  // Returns errc::cancelled when a non-zero timeout passes without moving data or the token is cancelled.
+  async<std::error_code> splice(
+    socket& other, std::uint64_t& count, std::chrono::milliseconds timeout = {},
+    cancellation_token token = {}) noexcept;
+
+  // Reads datagrams from the socket into the buffer and yields them with the address of the peer.
+  // Datagrams that are larger than the buffer are truncated.
+  // Datagrams that the kernel coalesced with the gro option are yielded one by one as views of the buffer.
+  // Sets ec_ and completes range on error.
+  // Sets ec_ to errc::cancelled when a non-zero timeout passes without receiving data or the token is cancelled.
+  local_async_generator<const datagram&> recv_from(
+    void* data, std::size_t size, std::chrono::milliseconds timeout = {}, cancellation_token token = {}) noexcept;
+
+  // Reads up to one datagram per buffer with a single system call (recvmmsg on Linux) and yields all datagrams that
+  // were available as a single batch. Datagrams that are larger than their buffer are truncated.
+  // Datagrams that the kernel coalesced into a buffer with the gro option are split into views of the buffer, so
+  // buffers of 64 KiB receive up to 64 datagrams each.
+  // Sets ec_ and completes range on error.
+  // Sets ec_ to errc::cancelled when a non-zero timeout passes without receiving data or the token is cancelled.
+  local_async_generator<const std::vector<datagram>&> recv_from(
+    std::vector<std::string>& buffers, std::chrono::milliseconds timeout = {}, cancellation_token token = {}) noexcept;
+
+  // Sends message as a single datagram to the peer or to the connected peer if the address is not set.
+  // Returns errc::cancelled when a non-zero timeout passes without sending data or the token is cancelled.
+  async<std::error_code> send_to(
+    const endpoint& peer, std::string_view message, std::chrono::milliseconds timeout = {},
+    cancellation_token token = {}) noexcept;
+
+  // Sends message as datagrams of segment bytes to the peer with UDP segmentation offload (Linux only).
+  // The last datagram can be smaller. The kernel splits up to 64 datagrams per system call.
+  // Sockets or platforms without segmentation offload send the datagrams with send_to.
+  // Returns errc::cancelled when a non-zero timeout passes without sending data or the token is cancelled.
+  async<std::error_code> send_segments(
+    const endpoint& peer, std::string_view message, std::size_t segment, std::chrono::milliseconds timeout = {},
+    cancellation_token token = {}) noexcept;
+
+  // Sends the datagrams in order with a single system call (sendmmsg on Linux) unless the socket buffer is full.
+  // Replies to a batch from recv_from can be collected and sent with one call per batch.
+  // Returns errc::cancelled when a non-zero timeout passes without sending data or the token is cancelled.
+  async<std::error_code> send_to(
+    const std::vector<datagram>& datagrams, std::chrono::milliseconds timeout = {},
+    cancellation_token token = {}) noexcept;
 
-  // Returns the last error set by recv(void*, std::size_t).
+  // Returns the last error set by recv.
   std::error_code ec() const noexcept {
     return ec_;
   }
@@ -54,6 +217,9 @@ public:
 protected:
   std::error_code ec_;
   std::reference_wrapper<events> events_;
+  descriptor* descriptor_ = nullptr;
+  bool zerocopy_ = false;
+  std::uint32_t zerocopy_id_ = 0;
 };
 
 }  // namespace coronet
@@ -0,0 +1,628 @@
+#pragma once
+#include <coronet/async.h>
+#include <coronet/events.h>
+#include <coronet/work.h>
+#include <atomic>
+#include <mutex>
+#include <utility>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+namespace coronet {
+
+class async_mutex;
+class async_semaphore;
+class async_manual_reset_event;
+class local_async_mutex;
+class local_async_semaphore;
+class local_async_manual_reset_event;
+
+namespace detail {
+
+// Coroutine that waits for a synchronization primitive.
+// Resumed on the events queue that it was suspended on or on the waking thread if it does not run on an events queue.
+class waiter : public work {
+public:
+  void operator()() noexcept override {
+    handle_.resume();
+  }
+
+protected:
+  void suspend(coroutine_handle<> handle) noexcept {
+    handle_ = handle;
+    events_ = events::current();
+  }
+
+  void wake() noexcept {
+    if (!events_ || events_ == events::current()) {
+      handle_.resume();
+    } else {
+      events_->post(*this);
+    }
+  }
+
+private:
+  friend class coronet::async_mutex;
+  friend class coronet::async_semaphore;
+  friend class coronet::async_manual_reset_event;
+
+  coroutine_handle<> handle_ = nullptr;
+  events* events_ = nullptr;
+  waiter* next_ = nullptr;
+};
+
+// Coroutine that waits for a loop-local synchronization primitive. Resumed inline.
+class local_waiter {
+protected:
+  coroutine_handle<> handle_ = nullptr;
+  local_waiter* next_ = nullptr;
+
+  friend class coronet::local_async_mutex;
+  friend class coronet::local_async_semaphore;
+  friend class coronet::local_async_manual_reset_event;
+};
+
+}  // namespace detail
+
+// Unlocks the mutex when destroyed.
+template <typename Mutex>
+class async_lock final {
+public:
+  async_lock(Mutex& mutex, std::adopt_lock_t) noexcept : mutex_(&mutex) {
+  }
+
+  async_lock(async_lock&& other) noexcept : mutex_(std::exchange(other.mutex_, nullptr)) {
+  }
+
+  async_lock& operator=(async_lock&& other) = delete;
+
+  ~async_lock() {
+    if (mutex_) {
+      mutex_->unlock();
+    }
+  }
+
+private:
+  Mutex* mutex_;
+};
+
+// Mutex that suspends coroutines instead of blocking the thread. Can be used from any thread.
+// The waiter list is a lock-free stack that the lock holder moves to a FIFO list on unlock.
+class async_mutex final {
+public:
+  class lock_operation final : public detail::waiter {
+  public:
+    explicit lock_operation(async_mutex& mutex) noexcept : mutex_(mutex) {
+    }
+
+    bool await_ready() noexcept {
+      return mutex_.try_lock();
+    }
+
+    bool await_suspend(coroutine_handle<> handle) noexcept {
+      suspend(handle);
+      auto state = mutex_.state_.load(std::memory_order_acquire);
+      while (true) {
+        if (state == not_locked) {
+          if (mutex_.state_.compare_exchange_weak(
+                state, locked, std::memory_order_acquire, std::memory_order_relaxed)) {
+            return false;
+          }
+          continue;
+        }
+        next_ = state == locked ? nullptr : reinterpret_cast<detail::waiter*>(state);
+        const auto self = reinterpret_cast<std::uintptr_t>(static_cast<detail::waiter*>(this));
+        if (mutex_.state_.compare_exchange_weak(state, self, std::memory_order_release, std::memory_order_relaxed)) {
+          return true;
+        }
+      }
+    }
+
+    constexpr void await_resume() noexcept {
+    }
+
+  private:
+    async_mutex& mutex_;
+  };
+
+  class scoped_lock_operation final {
+  public:
+    explicit scoped_lock_operation(async_mutex& mutex) noexcept : operation_(mutex), mutex_(mutex) {
+    }
+
+    bool await_ready() noexcept {
+      return operation_.await_ready();
+    }
+
+    bool await_suspend(coroutine_handle<> handle) noexcept {
+      return operation_.await_suspend(handle);
+    }
+
+    async_lock<async_mutex> await_resume() noexcept {
+      return { mutex_, std::adopt_lock };
+    }
+
+  private:
+    lock_operation operation_;
+    async_mutex& mutex_;
+  };
+
+  async_mutex() noexcept = default;
+
+  async_mutex(async_mutex&& other) = delete;
+  async_mutex& operator=(async_mutex&& other) = delete;
+
+  ~async_mutex() {
+    assert(state_.load(std::memory_order_relaxed) == not_locked);
+  }
+
+  // Locks the mutex if it is not locked. Returns true on success.
+  bool try_lock() noexcept {
+    auto state = not_locked;
+    return state_.compare_exchange_strong(state, locked, std::memory_order_acquire, std::memory_order_relaxed);
+  }
+
+  // Returns awaitable that locks the mutex.
+  lock_operation lock() noexcept {
+    return lock_operation(*this);
+  }
+
+  // Returns awaitable that locks the mutex and returns a lock that unlocks it.
+  scoped_lock_operation scoped_lock() noexcept {
+    return scoped_lock_operation(*this);
+  }
+
+  // Unlocks the mutex and hands it to the coroutine that waits the longest.
+  void unlock() noexcept {
+    assert(state_.load(std::memory_order_relaxed) != not_locked);
+    auto head = waiters_;
+    if (!head) {
+      auto state = locked;
+      if (state_.compare_exchange_strong(state, not_locked, std::memory_order_release, std::memory_order_relaxed)) {
+        return;
+      }
+
+      // Move new waiters to the FIFO list.
+      state = state_.exchange(locked, std::memory_order_acquire);
+      auto waiter = reinterpret_cast<detail::waiter*>(state);
+      while (waiter) {
+        const auto next = waiter->next_;
+        waiter->next_ = head;
+        head = waiter;
+        waiter = next;
+      }
+    }
+    waiters_ = head->next_;
+    head->wake();
+  }
+
+private:
+  // The state is not_locked, locked or the address of the most recent waiter.
+  constexpr static std::uintptr_t not_locked = 1;
+  constexpr static std::uintptr_t locked = 0;
+
+  std::atomic<std::uintptr_t> state_ = not_locked;
+  detail::waiter* waiters_ = nullptr;
+};
+
+// Counting semaphore that suspends coroutines instead of blocking the thread. Can be used from any thread.
+// The waiter list is protected by a spin lock that is only held to link or unlink waiters.
+class async_semaphore final {
+public:
+  class acquire_operation final : public detail::waiter {
+  public:
+    explicit acquire_operation(async_semaphore& semaphore) noexcept : semaphore_(semaphore) {
+    }
+
+    bool await_ready() noexcept {
+      return semaphore_.try_acquire();
+    }
+
+    bool await_suspend(coroutine_handle<> handle) noexcept {
+      suspend(handle);
+      semaphore_.lock();
+      if (semaphore_.try_acquire()) {
+        semaphore_.unlock();
+        return false;
+      }
+      if (semaphore_.tail_) {
+        semaphore_.tail_->next_ = this;
+      } else {
+        semaphore_.head_ = this;
+      }
+      semaphore_.tail_ = this;
+      semaphore_.unlock();
+      return true;
+    }
+
+    constexpr void await_resume() noexcept {
+    }
+
+  private:
+    async_semaphore& semaphore_;
+  };
+
+  explicit async_semaphore(std::size_t count) noexcept : count_(count) {
+  }
+
+  async_semaphore(async_semaphore&& other) = delete;
+  async_semaphore& operator=(async_semaphore&& other) = delete;
+
+  ~async_semaphore() = default;
+
+  // Acquires a permit if one is available. Returns true on success.
+  bool try_acquire() noexcept {
+    auto count = count_.load(std::memory_order_relaxed);
+    while (count > 0) {
+      if (count_.compare_exchange_weak(count, count - 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Returns awaitable that acquires a permit.
+  acquire_operation acquire() noexcept {
+    return acquire_operation(*this);
+  }
+
+  // Releases the given number of permits and hands them to the coroutines that wait the longest.
+  void release(std::size_t count = 1) noexcept {
+    detail::waiter* head = nullptr;
+    lock();
+    if (count && head_) {
+      head = head_;
+      auto tail = head_;
+      count--;
+      while (count && tail->next_) {
+        tail = tail->next_;
+        count--;
+      }
+      head_ = tail->next_;
+      if (!head_) {
+        tail_ = nullptr;
+      }
+      tail->next_ = nullptr;
+    }
+    count_.fetch_add(count, std::memory_order_release);
+    unlock();
+    while (head) {
+      const auto next = head->next_;
+      head->wake();
+      head = next;
+    }
+  }
+
+private:
+  void lock() noexcept {
+    while (lock_.exchange(true, std::memory_order_acquire)) {
+      while (lock_.load(std::memory_order_relaxed)) {
+      }
+    }
+  }
+
+  void unlock() noexcept {
+    lock_.store(false, std::memory_order_release);
+  }
+
+  std::atomic<std::size_t> count_;
+  std::atomic<bool> lock_ = false;
+  detail::waiter* head_ = nullptr;
+  detail::waiter* tail_ = nullptr;
+};
+
+// Event that resumes all waiting coroutines when it is set and stays set until it is reset.
+// Can be used from any thread.
+class async_manual_reset_event final {
+public:
+  class wait_operation final : public detail::waiter {
+  public:
+    explicit wait_operation(async_manual_reset_event& event) noexcept : event_(event) {
+    }
+
+    bool await_ready() noexcept {
+      return event_.is_set();
+    }
+
+    bool await_suspend(coroutine_handle<> handle) noexcept {
+      suspend(handle);
+      const auto set = static_cast<const void*>(&event_);
+      auto state = event_.state_.load(std::memory_order_acquire);
+      do {
+        if (state == set) {
+          return false;
+        }
+        next_ = static_cast<detail::waiter*>(const_cast<void*>(state));
+      } while (!event_.state_.compare_exchange_weak(
+        state, static_cast<detail::waiter*>(this), std::memory_order_release, std::memory_order_acquire));
+      return true;
+    }
+
+    constexpr void await_resume() noexcept {
+    }
+
+  private:
+    async_manual_reset_event& event_;
+  };
+
+  explicit async_manual_reset_event(bool set = false) noexcept : state_(set ? this : nullptr) {
+  }
+
+  async_manual_reset_event(async_manual_reset_event&& other) = delete;
+  async_manual_reset_event& operator=(async_manual_reset_event&& other) = delete;
+
+  ~async_manual_reset_event() = default;
+
+  // Returns true if the event is set.
+  bool is_set() const noexcept {
+    return state_.load(std::memory_order_acquire) == this;
+  }
+
+  // Returns awaitable that waits until the event is set.
+  wait_operation operator co_await() noexcept {
+    return wait_operation(*this);
+  }
+
+  // Sets the event and resumes all waiting coroutines.
+  void set() noexcept {
+    const auto state = state_.exchange(this, std::memory_order_acq_rel);
+    if (state == this) {
+      return;
+    }
+    auto waiter = static_cast<detail::waiter*>(const_cast<void*>(state));
+    while (waiter) {
+      const auto next = waiter->next_;
+      waiter->wake();
+      waiter = next;
+    }
+  }
+
+  // Resets the event if it is set.
+  void reset() noexcept {
+    const void* state = this;
+    state_.compare_exchange_strong(state, nullptr, std::memory_order_relaxed);
+  }
+
+private:
+  // The state is the address of the event when it is set or the address of the most recent waiter.
+  std::atomic<const void*> state_;
+};
+
+// Mutex for coroutines that run on the same events queue.
+class local_async_mutex final {
+public:
+  class lock_operation final : public detail::local_waiter {
+  public:
+    explicit lock_operation(local_async_mutex& mutex) noexcept : mutex_(mutex) {
+    }
+
+    bool await_ready() noexcept {
+      return mutex_.try_lock();
+    }
+
+    void await_suspend(coroutine_handle<> handle) noexcept {
+      handle_ = handle;
+      if (mutex_.tail_) {
+        mutex_.tail_->next_ = this;
+      } else {
+        mutex_.head_ = this;
+      }
+      mutex_.tail_ = this;
+    }
+
+    constexpr void await_resume() noexcept {
+    }
+
+  private:
+    local_async_mutex& mutex_;
+  };
+
+  class scoped_lock_operation final {
+  public:
+    explicit scoped_lock_operation(local_async_mutex& mutex) noexcept : operation_(mutex), mutex_(mutex) {
+    }
+
+    bool await_ready() noexcept {
+      return operation_.await_ready();
+    }
+
+    void await_suspend(coroutine_handle<> handle) noexcept {
+      operation_.await_suspend(handle);
+    }
+
+    async_lock<local_async_mutex> await_resume() noexcept {
+      return { mutex_, std::adopt_lock };
+    }
+
+  private:
+    lock_operation operation_;
+    local_async_mutex& mutex_;
+  };
+
+  local_async_mutex() noexcept = default;
+
+  local_async_mutex(local_async_mutex&& other) = delete;
+  local_async_mutex& operator=(local_async_mutex&& other) = delete;
+
+  ~local_async_mutex() {
+    assert(!locked_);
+  }
+
+  // Locks the mutex if it is not locked. Returns true on success.
+  bool try_lock() noexcept {
+    return !std::exchange(locked_, true);
+  }
+
+  // Returns awaitable that locks the mutex.
+  lock_operation lock() noexcept {
+    return lock_operation(*this);
+  }
+
+  // Returns awaitable that locks the mutex and returns a lock that unlocks it.
+  scoped_lock_operation scoped_lock() noexcept {
+    return scoped_lock_operation(*this);
+  }
+
+  // Unlocks the mutex and resumes the coroutine that waits the longest.
+  void unlock() noexcept {
+    assert(locked_);
+    const auto head = head_;
+    if (!head) {
+      locked_ = false;
+      return;
+    }
+    head_ = head->next_;
+    if (!head_) {
+      tail_ = nullptr;
+    }
+    head->handle_.resume();
+  }
+
+private:
+  bool locked_ = false;
+  detail::local_waiter* head_ = nullptr;
+  detail::local_waiter* tail_ = nullptr;
+};
+
+// Counting semaphore for coroutines that run on the same events queue.
+class local_async_semaphore final {
+public:
+  class acquire_operation final : public detail::local_waiter {
+  public:
+    explicit acquire_operation(local_async_semaphore& semaphore) noexcept : semaphore_(semaphore) {
+    }
+
+    bool await_ready() noexcept {
+      return semaphore_.try_acquire();
+    }
+
+    void await_suspend(coroutine_handle<> handle) noexcept {
+      handle_ = handle;
+      if (semaphore_.tail_) {
+        semaphore_.tail_->next_ = this;
+      } else {
+        semaphore_.head_ = this;
+      }
+      semaphore_.tail_ = this;
+    }
+
+    constexpr void await_resume() noexcept {
+    }
+
+  private:
+    local_async_semaphore& semaphore_;
+  };
+
+  explicit local_async_semaphore(std::size_t count) noexcept : count_(count) {
+  }
+
+  local_async_semaphore(local_async_semaphore&& other) = delete;
+  local_async_semaphore& operator=(local_async_semaphore&& other) = delete;
+
+  ~local_async_semaphore() = default;
+
+  // Acquires a permit if one is available. Returns true on success.
+  bool try_acquire() noexcept {
+    if (!count_) {
+      return false;
+    }
+    count_--;
+    return true;
+  }
+
+  // Returns awaitable that acquires a permit.
+  acquire_operation acquire() noexcept {
+    return acquire_operation(*this);
+  }
+
+  // Releases the given number of permits and resumes the coroutines that wait the longest.
+  void release(std::size_t count = 1) noexcept {
+    for (; count && head_; count--) {
+      const auto head = head_;
+      head_ = head->next_;
+      if (!head_) {
+        tail_ = nullptr;
+      }
+      head->handle_.resume();
+    }
+    count_ += count;
+  }
+
+  // Returns the number of available permits.
+  std::size_t available() const noexcept {
+    return count_;
+  }
+
+private:
+  std::size_t count_;
+  detail::local_waiter* head_ = nullptr;
+  detail::local_waiter* tail_ = nullptr;
+};
+
+// Event for coroutines that run on the same events queue.
+// Resumes all waiting coroutines when it is set and stays set until it is reset.
+class local_async_manual_reset_event final {
+public:
+  class wait_operation final : public detail::local_waiter {
+  public:
+    explicit wait_operation(local_async_manual_reset_event& event) noexcept : event_(event) {
+    }
+
+    bool await_ready() noexcept {
+      return event_.is_set();
+    }
+
+    void await_suspend(coroutine_handle<> handle) noexcept {
+      handle_ = handle;
+      next_ = event_.head_;
+      event_.head_ = this;
+    }
+
+    constexpr void await_resume() noexcept {
+    }
+
+  private:
+    local_async_manual_reset_event& event_;
+  };
+
+  explicit local_async_manual_reset_event(bool set = false) noexcept : set_(set) {
+  }
+
+  local_async_manual_reset_event(local_async_manual_reset_event&& other) = delete;
+  local_async_manual_reset_event& operator=(local_async_manual_reset_event&& other) = delete;
+
+  ~local_async_manual_reset_event() = default;
+
+  // Returns true if the event is set.
+  bool is_set() const noexcept {
+    return set_;
+  }
+
+  // Returns awaitable that waits until the event is set.
+  wait_operation operator co_await() noexcept {
+    return wait_operation(*this);
+  }
+
+  // Sets the event and resumes all waiting coroutines.
+  void set() noexcept {
+    set_ = true;
+    auto waiter = std::exchange(head_, nullptr);
+    while (waiter) {
+      const auto next = waiter->next_;
+      waiter->handle_.resume();
+      waiter = next;
+    }
+  }
+
+  // Resets the event if it is set.
+  void reset() noexcept {
+    set_ = false;
+  }
+
+private:
+  bool set_;
+  detail::local_waiter* head_ = nullptr;
+};
+
+}  // namespace coronet
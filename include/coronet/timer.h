@@ -0,0 +1,36 @@
+#pragma once
+#include <cstdint>
+
+namespace coronet {
+
+class wheel;
+
+// Intrusive entry in the timing wheel of an events queue.
+class timer {
+public:
+  timer() noexcept = default;
+
+  timer(timer&& other) = delete;
+  timer& operator=(timer&& other) = delete;
+
+  // Called by events::run when the timer expires.
+  virtual void operator()() noexcept = 0;
+
+  // Returns true if the timer is armed.
+  bool armed() const noexcept {
+    return bucket_ != nullptr;
+  }
+
+protected:
+  ~timer() = default;
+
+private:
+  friend class wheel;
+
+  timer* prev_ = nullptr;
+  timer* next_ = nullptr;
+  timer** bucket_ = nullptr;
+  std::uint64_t expiry_ = 0;
+};
+
+}  // namespace coronet
@@ -0,0 +1,27 @@
+#pragma once
+
+namespace coronet {
+
+class work_queue;
+
+// Intrusive work item that is posted to an events queue.
+class work {
+public:
+  work() noexcept = default;
+
+  work(work&& other) = delete;
+  work& operator=(work&& other) = delete;
+
+  // Called on the thread that runs the events queue.
+  virtual void operator()() noexcept = 0;
+
+protected:
+  ~work() = default;
+
+private:
+  friend class work_queue;
+
+  work* next_ = nullptr;
+};
+
+}  // namespace coronet
@@ -0,0 +1,49 @@
+#include <coronet/socket.h>
+#include <coronet/address.h>
+#include <cstring>
+
+#ifndef WIN32
+#include <netinet/in.h>
+#endif
+
+namespace coronet {
+
+std::error_code endpoint::create(const std::string& host, const std::string& port) noexcept {
+  address address;
+  if (const auto ec = address.create(host, port, type::udp, 0)) {
+    return ec;
+  }
+  const auto size = static_cast<std::size_t>(address.addrlen());
+  if (size > capacity) {
+    return { static_cast<int>(std::errc::invalid_argument), error_category() };
+  }
+  std::memcpy(storage_, address.addr(), size);
+  size_ = size;
+  return {};
+}
+
+std::string endpoint::host() const {
+  if (!size_) {
+    return {};
+  }
+  char host[NI_MAXHOST] = {};
+  const auto addr = reinterpret_cast<const sockaddr*>(storage_);
+  const auto size = static_cast<socklen_t>(size_);
+  if (::getnameinfo(addr, size, host, sizeof(host), nullptr, 0, NI_NUMERICHOST) != 0) {
+    return {};
+  }
+  return host;
+}
+
+std::uint16_t endpoint::port() const noexcept {
+  if (!size_) {
+    return 0;
+  }
+  switch (reinterpret_cast<const sockaddr*>(storage_)->sa_family) {
+  case AF_INET: return ntohs(reinterpret_cast<const sockaddr_in*>(storage_)->sin_port);
+  case AF_INET6: return ntohs(reinterpret_cast<const sockaddr_in6*>(storage_)->sin6_port);
+  }
+  return 0;
+}
+
+}  // namespace coronet
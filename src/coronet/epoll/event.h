@@ -1,46 +1,277 @@
 #pragma once
+#include <coronet/error.h>
+#include <coronet/events.h>
+#include <coronet/queue.h>
+#include <coronet/wheel.h>
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
 #include <experimental/coroutine>
+#include <atomic>
+#include <chrono>
+#include <utility>
+#include <cassert>
+#include <cerrno>
 #include <cstddef>
+#include <cstdint>
 
 namespace coronet {
 
-class event final : public epoll_event {
+class event;
+
+// Persistent edge-triggered registration of a socket in the epoll queue.
+class descriptor final {
+public:
+  // Resumes the read and write waiters that are affected by the given epoll events.
+  void operator()(std::uint32_t events) noexcept;
+
+  event* reader_ = nullptr;
+  event* writer_ = nullptr;
+  descriptor* next_ = nullptr;
+};
+
+class events::state final {
+public:
+  // Events that are reported for every registered socket.
+  constexpr static std::uint32_t filter = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+
+  explicit state(int events) noexcept : events_(events) {
+  }
+
+  state(state&& other) = delete;
+  state& operator=(state&& other) = delete;
+
+  ~state() {
+    collect();
+    while (free_) {
+      delete std::exchange(free_, free_->next_);
+    }
+    if (wakeup_ != -1) {
+      ::close(wakeup_);
+    }
+  }
+
+  // Creates the eventfd that wakes up events::run from other threads.
+  std::error_code create() noexcept {
+    wakeup_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeup_ < 0) {
+      return { errno, error_category() };
+    }
+    struct ::epoll_event ev = {};
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.ptr = nullptr;
+    if (::epoll_ctl(events_, EPOLL_CTL_ADD, wakeup_, &ev) < 0) {
+      return { errno, error_category() };
+    }
+    return {};
+  }
+
+  // Requests events::run to return. Thread-safe and async-signal-safe.
+  void stop() noexcept {
+    stopped_.store(true, std::memory_order_release);
+    notify();
+  }
+
+  // Queues the work item and wakes up events::run if the queue was empty. Thread-safe and async-signal-safe.
+  void post(work& work) noexcept {
+    if (queue_.push(work)) {
+      notify();
+    }
+  }
+
+  // Handles a wakeup notification and calls posted work items. Returns true if events::run should return.
+  bool wakeup() noexcept {
+    std::uint64_t value = 0;
+    [[maybe_unused]] const auto rv = ::read(wakeup_, &value, sizeof(value));
+    queue_.run();
+    return stopped_.exchange(false, std::memory_order_acq_rel);
+  }
+
+  // Registers the socket in the epoll queue for the lifetime of the descriptor.
+  std::error_code attach(int socket, descriptor*& descriptor) noexcept {
+    auto entry = free_ ? std::exchange(free_, free_->next_) : new class descriptor;
+    struct ::epoll_event ev = {};
+    ev.events = filter;
+    ev.data.ptr = entry;
+    if (::epoll_ctl(events_, EPOLL_CTL_ADD, socket, &ev) < 0) {
+      entry->next_ = std::exchange(free_, entry);
+      return { errno, error_category() };
+    }
+    entry->next_ = nullptr;
+    descriptor = entry;
+    return {};
+  }
+
+  // Releases the descriptor when the socket is closed.
+  // The descriptor is not reused before the current batch of epoll events is handled.
+  void detach(descriptor*& descriptor) noexcept {
+    if (const auto entry = std::exchange(descriptor, nullptr)) {
+      entry->reader_ = nullptr;
+      entry->writer_ = nullptr;
+      entry->next_ = std::exchange(retired_, entry);
+    }
+  }
+
+  // Unregisters a file that stays open after it was used with the descriptor and releases the descriptor.
+  void detach(int file, descriptor*& descriptor) noexcept {
+    if (descriptor) {
+      ::epoll_ctl(events_, EPOLL_CTL_DEL, file, nullptr);
+      detach(descriptor);
+    }
+  }
+
+  // Returns the timing wheel of the events queue.
+  wheel& timers() noexcept {
+    return timers_;
+  }
+
+  // Makes descriptors that were released during the last batch of epoll events available for reuse.
+  void collect() noexcept {
+    while (retired_) {
+      const auto entry = std::exchange(retired_, retired_->next_);
+      entry->next_ = std::exchange(free_, entry);
+    }
+  }
+
+private:
+  void notify() noexcept {
+    const std::uint64_t value = 1;
+    [[maybe_unused]] const auto rv = ::write(wakeup_, &value, sizeof(value));
+  }
+
+  int events_ = -1;
+  int wakeup_ = -1;
+  std::atomic<bool> stopped_ = false;
+  work_queue queue_;
+  descriptor* free_ = nullptr;
+  descriptor* retired_ = nullptr;
+  wheel timers_;
+};
+
+class event final {
 public:
   using handle_type = std::experimental::coroutine_handle<>;
 
-  event(int events, int socket, uint32_t filter) noexcept : epoll_event({}), events_(events), socket_(socket) {
-    const auto ev = static_cast<struct ::epoll_event*>(this);
-    ev->events = filter;
-    ev->data.ptr = this;
+  event(
+    events& events, descriptor*& descriptor, int socket, std::uint32_t filter, std::chrono::milliseconds timeout = {},
+    cancellation_token token = {}) noexcept :
+    events_(events), descriptor_(descriptor), socket_(socket), filter_(filter), timeout_(timeout), token_(token),
+    deadline_(*this) {
   }
 
   event(event&& event) = delete;
   event& operator=(event&& other) = delete;
 
-  ~event() = default;
+  // A suspended frame can be destroyed while it waits, so the descriptor must not keep pointing to this event.
+  ~event() {
+    if (deadline_.armed() || deadline_.registered()) {
+      disarm();
+    }
+    release();
+  }
 
   constexpr bool await_ready() noexcept {
     return false;
   }
 
-  void await_suspend(handle_type handle) noexcept {
+  bool await_suspend(handle_type handle) noexcept {
+    ec_.clear();
+    const auto state = events_.data();
+    if (!state) {
+      ec_ = { static_cast<int>(std::errc::bad_file_descriptor), error_category() };
+      return false;
+    }
+    if (!descriptor_) {
+      if (const auto ec = state->attach(socket_, descriptor_)) {
+        ec_ = ec;
+        return false;
+      }
+    }
+    if (!token_.attach(deadline_)) {
+      ec_ = errc::cancelled;
+      return false;
+    }
+    auto& waiter = this->waiter();
+    assert(!waiter);
+    waiter = this;
     handle_ = handle;
-    ::epoll_ctl(events_, EPOLL_CTL_ADD, socket_, this);
+    if (timeout_.count() > 0) {
+      state->timers().start(deadline_, timeout_);
+    }
+    return true;
   }
 
-  constexpr void await_resume() noexcept {
+  std::error_code await_resume() noexcept {
+    return ec_;
   }
 
   void operator()() noexcept {
-    ::epoll_ctl(events_, EPOLL_CTL_DEL, socket_, this);
+    disarm();
     handle_.resume();
   }
 
 private:
+  // Completes the wait with errc::cancelled when the timeout expires or the token is cancelled.
+  class deadline final : public timer, public cancellation_callback {
+  public:
+    explicit deadline(event& event) noexcept : event_(event) {
+    }
+
+    void operator()() noexcept override {
+      event_.disarm();
+      event_.release();
+      event_.ec_ = errc::cancelled;
+      event_.handle_.resume();
+    }
+
+  private:
+    event& event_;
+  };
+
+  event*& waiter() noexcept {
+    return filter_ & EPOLLOUT ? descriptor_->writer_ : descriptor_->reader_;
+  }
+
+  // Cancels the timeout and unregisters the cancellation callback.
+  void disarm() noexcept {
+    if (deadline_.armed()) {
+      events_.cancel(deadline_);
+    }
+    deadline_.reset();
+  }
+
+  // Stops waiting for readiness of a socket that is still registered.
+  void release() noexcept {
+    if (descriptor_) {
+      if (auto& waiter = this->waiter(); waiter == this) {
+        waiter = nullptr;
+      }
+    }
+  }
+
+  events& events_;
+  descriptor*& descriptor_;
   handle_type handle_ = nullptr;
-  int events_ = -1;
+  std::error_code ec_;
   int socket_ = -1;
+  std::uint32_t filter_ = 0;
+  std::chrono::milliseconds timeout_;
+  cancellation_token token_;
+  deadline deadline_;
 };
 
+inline void descriptor::operator()(std::uint32_t events) noexcept {
+  // Resuming the reader can close the socket and detach this descriptor, which resets the writer.
+  if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+    if (const auto reader = std::exchange(reader_, nullptr)) {
+      (*reader)();
+    }
+  }
+  if (events & (EPOLLOUT | EPOLLHUP | EPOLLERR)) {
+    if (const auto writer = std::exchange(writer_, nullptr)) {
+      (*writer)();
+    }
+  }
+}
+
 }  // namespace coronet
@@ -1,19 +1,43 @@
 #include <coronet/events.h>
 #include <coronet/epoll/event.h>
+#include <coronet/thread.h>
+#include <sys/ioctl.h>
 #include <unistd.h>
-#include <array>
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <vector>
 #include <cerrno>
 
+#ifndef EPIOCSPARAMS
+// Busy poll parameters of an epoll instance (Linux 6.9).
+struct epoll_params {
+  std::uint32_t busy_poll_usecs;
+  std::uint16_t busy_poll_budget;
+  std::uint8_t prefer_busy_poll;
+  std::uint8_t pad;
+};
+#define EPIOCSPARAMS _IOW(0x8A, 0x01, struct epoll_params)
+#endif
+
 namespace coronet {
 
+events::~events() {
+  delete state_;
+}
+
 std::error_code events::create() noexcept {
-  // Create a new kqueue handle.
+  // Create a new epoll handle.
   events events(epoll_create1(0));
   if (!events) {
     return { errno, error_category() };
   }
+  events.state_ = new state(events.value());
+  if (const auto ec = events.state_->create()) {
+    return ec;
+  }
 
-  // Replace current kqueue handle.
+  // Replace current epoll handle.
   if (const auto ec = close()) {
     return ec;
   }
@@ -21,35 +45,104 @@ std::error_code events::create() noexcept {
   return {};
 }
 
-std::error_code events::run(int processor) {
+std::error_code events::run(int processor, const policy& policy) {
   if (!valid()) {
     return { static_cast<int>(std::errc::bad_file_descriptor), error_category() };
   }
 
+  // Pin the current thread to the given processor.
+  if (processor >= 0) {
+    if (const auto ec = set_affinity(processor)) {
+      return ec;
+    }
+  }
+
+  // Enable busy polling of network device queues.
+  if (policy.busy_poll.count() > 0) {
+    struct epoll_params params = {};
+    params.busy_poll_usecs = static_cast<std::uint32_t>(policy.busy_poll.count());
+    params.busy_poll_budget = 8;
+    params.prefer_busy_poll = 1;
+    if (::ioctl(handle_, EPIOCSPARAMS, &params) < 0 && errno != ENOTTY) {
+      return { errno, error_category() };
+    }
+  }
+
+  // Make the events queue available to coroutines that run on this thread.
+  const auto previous = std::exchange(current_, this);
+
   // Handle completed events.
   std::error_code ec;
-  std::array<epoll_event, 32> events;
-  const auto events_data = events.data();
-  const auto events_size = events.size();
-  while (true) {
-    const auto count = ::epoll_wait(handle_, events_data, events_size, -1);
+  auto& state = *state_;
+  auto stopped = false;
+  std::vector<epoll_event> events(std::max(policy.batch, std::size_t(1)));
+  const auto batch_max = std::min<std::size_t>(policy.batch_max, std::numeric_limits<int>::max());
+  auto& timers = state.timers();
+  auto spin = std::chrono::steady_clock::time_point();
+  while (!stopped) {
+    auto timeout = -1;
+    if (const auto ticks = timers.timeout(); ticks != wheel::infinite) {
+      timeout = static_cast<int>(std::min<std::uint64_t>(ticks, std::numeric_limits<int>::max()));
+    }
+    if (policy.spin.count() > 0 && timeout && std::chrono::steady_clock::now() < spin) {
+      timeout = 0;
+    }
+    const auto events_size = static_cast<int>(events.size());
+    const auto count = ::epoll_wait(handle_, events.data(), events_size, timeout);
     if (count < 0) {
-      if (errno != EINTR) {
-        ec = { errno, error_category() };
+      // Signal handlers stop the events queue with events::stop.
+      if (errno == EINTR) {
+        continue;
       }
+      ec = { errno, error_category() };
       break;
     }
+    if (count > 0 && policy.spin.count() > 0) {
+      spin = std::chrono::steady_clock::now() + policy.spin;
+    }
     for (std::size_t i = 0, max = static_cast<std::size_t>(count); i < max; i++) {
       const auto& ev = events[i];
       if (ev.data.ptr) {
-        auto& handler = *static_cast<event*>(ev.data.ptr);
-        handler();
+        auto& handler = *static_cast<descriptor*>(ev.data.ptr);
+        handler(ev.events);
+      } else if (state.wakeup()) {
+        stopped = true;
       }
     }
+    timers.advance();
+    state.collect();
+    if (count == events_size && events.size() < batch_max) {
+      events.resize(std::min(events.size() * 2, batch_max));
+    }
   }
+  current_ = previous;
   return ec;
 }
 
+void events::stop() noexcept {
+  if (state_) {
+    state_->stop();
+  }
+}
+
+void events::start(timer& timer, std::chrono::milliseconds duration) noexcept {
+  if (state_) {
+    state_->timers().start(timer, duration);
+  }
+}
+
+void events::cancel(timer& timer) noexcept {
+  if (state_) {
+    state_->timers().cancel(timer);
+  }
+}
+
+void events::post(work& work) noexcept {
+  if (state_) {
+    state_->post(work);
+  }
+}
+
 std::error_code events::close() noexcept {
   if (valid()) {
     if (::close(handle_) < 0) {
@@ -3,10 +3,12 @@
 #include <coronet/epoll/event.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <linux/filter.h>
+#include <unistd.h>
 
 namespace coronet {
 
-std::error_code server::create(const std::string& host, const std::string& port, type type) noexcept {
+std::error_code server::create(const std::string& host, const std::string& port, type type, bool reuseport) noexcept {
   if (!events_.get()) {
     return { static_cast<int>(std::errc::bad_file_descriptor), error_category() };
   }
@@ -29,6 +31,14 @@ std::error_code server::create(const std::string& host, const std::string& port,
     return { errno, error_category() };
   }
 
+  // Set SO_REUSEPORT socket option.
+  if (reuseport) {
+    auto value = 1;
+    if (::setsockopt(server.value(), SOL_SOCKET, SO_REUSEPORT, &value, sizeof(value)) < 0) {
+      return { errno, error_category() };
+    }
+  }
+
   // Bind listening socket to the given address.
   if (::bind(server.value(), address.addr(), address.addrlen()) < 0) {
     return { errno, error_category() };
@@ -45,7 +55,56 @@ std::error_code server::create(const std::string& host, const std::string& port,
   return {};
 }
 
-async_generator<socket> server::accept(std::size_t backlog) noexcept {
+std::error_code server::create(const server& other) noexcept {
+  if (!events_.get()) {
+    return { static_cast<int>(std::errc::bad_file_descriptor), error_category() };
+  }
+
+  // Duplicate listening socket.
+  server server(events_, ::dup(other.value()));
+  if (!server) {
+    return { errno, error_category() };
+  }
+
+  // Replace current socket.
+  if (const auto ec = close()) {
+    return ec;
+  }
+  *this = std::move(server);
+  protocol_ = other.protocol_;
+  family_ = other.family_;
+  type_ = other.type_;
+  return {};
+}
+
+std::error_code server::steer(const std::vector<int>& processors) noexcept {
+  if (processors.empty() || processors.size() > BPF_MAXINSNS / 2 - 1) {
+    return { static_cast<int>(std::errc::invalid_argument), error_category() };
+  }
+
+  // Return the index of the first server that runs on the current processor.
+  // Indices that are out of range make the kernel fall back to hash based selection.
+  std::vector<struct sock_filter> code;
+  code.reserve(processors.size() * 2 + 2);
+  code.push_back(BPF_STMT(BPF_LD | BPF_W | BPF_ABS, static_cast<__u32>(SKF_AD_OFF + SKF_AD_CPU)));
+  for (std::size_t i = 0; i < processors.size(); i++) {
+    code.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, static_cast<__u32>(processors[i]), 0, 1));
+    code.push_back(BPF_STMT(BPF_RET | BPF_K, static_cast<__u32>(i)));
+  }
+  code.push_back(BPF_STMT(BPF_RET | BPF_K, static_cast<__u32>(processors.size())));
+
+  // Attach program to the reuseport group of the listening socket.
+  struct sock_fprog program = {};
+  program.len = static_cast<unsigned short>(code.size());
+  program.filter = code.data();
+  if (::setsockopt(handle_, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &program, sizeof(program)) < 0) {
+    return { errno, error_category() };
+  }
+  return {};
+}
+
+local_async_generator<socket> server::accept(
+  std::size_t backlog, std::chrono::milliseconds timeout, cancellation_token token) noexcept {
   ec_.clear();
 
   // Start listening on the socket.
@@ -57,7 +116,7 @@ async_generator<socket> server::accept(std::size_t backlog) noexcept {
   // Accept connections.
   struct sockaddr_storage storage;
   auto addr = reinterpret_cast<struct sockaddr*>(&storage);
-  event event(events_.get().value(), handle_, EPOLLIN);
+  event event(events_, descriptor_, handle_, EPOLLIN, timeout, token);
   while (true) {
     auto socklen = static_cast<socklen_t>(sizeof(storage));
     socket socket(events_, ::accept4(handle_, addr, &socklen, SOCK_NONBLOCK));
@@ -66,12 +125,11 @@ async_generator<socket> server::accept(std::size_t backlog) noexcept {
         ec_ = { errno, error_category() };
         co_return;
       }
-      co_await event;
-      socket.reset(::accept4(handle_, addr, &socklen, SOCK_NONBLOCK));
-      if (!socket) {
-        ec_ = { static_cast<int>(errc::eof), error_category() };
+      if (const auto ec = co_await event) {
+        ec_ = ec;
         co_return;
       }
+      continue;
     }
     co_yield socket;
   }
@@ -1,11 +1,54 @@
 #include <coronet/socket.h>
 #include <coronet/address.h>
 #include <coronet/epoll/event.h>
+#include <coronet/pipe.h>
+#include <coronet/udp.h>
+#include <sys/sendfile.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <linux/errqueue.h>
 #include <netinet/tcp.h>
 #include <unistd.h>
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <limits>
 
 namespace coronet {
+namespace {
+
+// Sends the buffers with sendmsg, which unlike writev does not raise SIGPIPE when the peer closed the connection.
+ssize_t send_vector(int socket, iovec* vector, std::size_t count) noexcept {
+  struct msghdr message = {};
+  message.msg_iov = vector;
+  message.msg_iovlen = static_cast<decltype(message.msg_iovlen)>(std::min<std::size_t>(count, IOV_MAX));
+  return ::sendmsg(socket, &message, MSG_NOSIGNAL);
+}
+
+// Reads zero-copy completion notifications from the error queue of the socket.
+// Returns the number of completed zero-copy sends.
+std::uint32_t released(int socket) noexcept {
+  std::uint32_t count = 0;
+  while (true) {
+    char control[CMSG_SPACE(sizeof(sock_extended_err))];
+    struct msghdr message = {};
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    if (::recvmsg(socket, &message, MSG_ERRQUEUE) < 0) {
+      return count;
+    }
+    for (auto cmsg = CMSG_FIRSTHDR(&message); cmsg; cmsg = CMSG_NXTHDR(&message, cmsg)) {
+      const auto error = reinterpret_cast<const sock_extended_err*>(CMSG_DATA(cmsg));
+      if (error->ee_errno == 0 && error->ee_origin == SO_EE_ORIGIN_ZEROCOPY) {
+        // Notifications cover the inclusive range of send calls from ee_info to ee_data.
+        count += error->ee_data - error->ee_info + 1;
+      }
+    }
+  }
+}
+
+}  // namespace
 
 std::error_code socket::create(family family, type type, int protocol) noexcept {
   if (!events_.get()) {
@@ -27,35 +70,52 @@ std::error_code socket::create(family family, type type, int protocol) noexcept
 }
 
 std::error_code socket::set(option option, bool enable) noexcept {
+  auto level = 0;
   auto sockopt = 0;
   switch (option) {
-  case option::nodelay: sockopt = TCP_NODELAY; break;
+  case option::nodelay:
+    level = IPPROTO_TCP;
+    sockopt = TCP_NODELAY;
+    break;
+  case option::gro:
+    level = IPPROTO_UDP;
+    sockopt = UDP_GRO;
+    break;
   }
   auto value = enable ? 1 : 0;
-  if (::setsockopt(handle_, SOL_SOCKET, sockopt, &value, sizeof(value)) < 0) {
+  if (::setsockopt(handle_, level, sockopt, &value, sizeof(value)) < 0) {
     return { errno, error_category() };
   }
   return {};
 }
 
+int socket::processor() const noexcept {
+  auto processor = -1;
+  auto size = static_cast<socklen_t>(sizeof(processor));
+  if (::getsockopt(handle_, SOL_SOCKET, SO_INCOMING_CPU, &processor, &size) < 0) {
+    return -1;
+  }
+  return processor;
+}
+
 // clang-format off
 
-async_generator<std::string_view> socket::recv(void* data, std::size_t size) noexcept {
+local_async_generator<std::string_view> socket::recv(
+  void* data, std::size_t size, std::chrono::milliseconds timeout, cancellation_token token) noexcept {
   ec_.clear();
-  event event(events_.get().value(), handle_, EPOLLIN);
+  event event(events_, descriptor_, handle_, EPOLLIN, timeout, token);
   while (true) {
-    std::int64_t rv = ::read(handle_, data, size);
+    const std::int64_t rv = ::read(handle_, data, size);
     if (rv < 0) {
       if (errno != EAGAIN) {
         ec_ = { errno, error_category() };
         co_return;
       }
-      co_await event;
-      rv = ::read(handle_, data, size);
-      if (rv < 0) {
-        ec_ = { errno, error_category() };
+      if (const auto ec = co_await event) {
+        ec_ = ec;
         co_return;
       }
+      continue;
     }
     if (rv == 0) {
       ec_ = { static_cast<int>(errc::eof), error_category() };
@@ -67,21 +127,182 @@ async_generator<std::string_view> socket::recv(void* data, std::size_t size) noe
   co_return;
 }
 
-async<std::error_code> socket::send(std::string_view message) noexcept {
+local_async_generator<const std::vector<std::string_view>&> socket::recv(
+  std::vector<std::string>& buffers, std::chrono::milliseconds timeout, cancellation_token token) noexcept {
+  ec_.clear();
+  if (std::all_of(buffers.begin(), buffers.end(), [](const auto& buffer) { return buffer.empty(); })) {
+    ec_ = { static_cast<int>(std::errc::invalid_argument), error_category() };
+    co_return;
+  }
+  event event(events_, descriptor_, handle_, EPOLLIN, timeout, token);
+  std::vector<iovec> chain(buffers.size());
+  std::vector<std::string_view> batch;
+  batch.reserve(buffers.size());
+  while (true) {
+    // Read until the socket has no more data or all buffers are full.
+    for (std::size_t i = 0; i < buffers.size(); i++) {
+      chain[i] = { buffers[i].data(), buffers[i].size() };
+    }
+    auto vector = chain.data();
+    auto count = chain.size();
+    std::error_code error;
+    while (count > 0) {
+      const auto rv = ::readv(handle_, vector, static_cast<int>(std::min<std::size_t>(count, IOV_MAX)));
+      if (rv < 0) {
+        if (errno != EAGAIN) {
+          error = { errno, error_category() };
+        }
+        break;
+      }
+      if (rv == 0) {
+        error = { static_cast<int>(errc::eof), error_category() };
+        break;
+      }
+      auto bytes = static_cast<std::size_t>(rv);
+      while (count > 0 && bytes >= vector->iov_len) {
+        bytes -= vector->iov_len;
+        vector->iov_len = 0;
+        vector++;
+        count--;
+      }
+      if (count > 0) {
+        vector->iov_base = static_cast<char*>(vector->iov_base) + bytes;
+        vector->iov_len -= bytes;
+      }
+    }
+
+    // Yield received data before reporting errors.
+    batch.clear();
+    for (std::size_t i = 0; i < buffers.size(); i++) {
+      if (const auto size = buffers[i].size() - chain[i].iov_len) {
+        batch.emplace_back(buffers[i].data(), size);
+      }
+    }
+    if (!batch.empty()) {
+      co_yield batch;
+    }
+    if (error) {
+      ec_ = error;
+      co_return;
+    }
+    if (batch.empty()) {
+      if (const auto ec = co_await event) {
+        ec_ = ec;
+        co_return;
+      }
+    }
+  }
+  co_return;
+}
+
+local_async_generator<const datagram&> socket::recv_from(
+  void* data, std::size_t size, std::chrono::milliseconds timeout, cancellation_token token) noexcept {
+  ec_.clear();
+  event event(events_, descriptor_, handle_, EPOLLIN, timeout, token);
+  datagram result;
+  segment_control control;
+  struct iovec vector = { data, size };
+  struct msghdr message = {};
+  message.msg_name = result.peer.data();
+  message.msg_iov = &vector;
+  message.msg_iovlen = 1;
+  while (true) {
+    message.msg_namelen = static_cast<socklen_t>(endpoint::capacity);
+    message.msg_control = control.data;
+    message.msg_controllen = sizeof(control.data);
+    const std::int64_t rv = ::recvmsg(handle_, &message, 0);
+    if (rv < 0) {
+      if (errno != EAGAIN) {
+        ec_ = { errno, error_category() };
+        co_return;
+      }
+      if (const auto ec = co_await event) {
+        ec_ = ec;
+        co_return;
+      }
+      continue;
+    }
+    result.peer.resize(message.msg_namelen);
+
+    // Datagrams that the kernel coalesced are yielded one by one.
+    const std::string_view received(reinterpret_cast<const char*>(data), static_cast<std::size_t>(rv));
+    const auto segment = get_segment_size(message);
+    const auto step = segment ? segment : received.size();
+    std::size_t offset = 0;
+    do {
+      result.data = received.substr(offset, step);
+      co_yield result;
+      offset += step;
+    } while (offset < received.size());
+  }
+  co_return;
+}
+
+local_async_generator<const std::vector<datagram>&> socket::recv_from(
+  std::vector<std::string>& buffers, std::chrono::milliseconds timeout, cancellation_token token) noexcept {
+  ec_.clear();
+  if (buffers.empty()) {
+    ec_ = { static_cast<int>(std::errc::invalid_argument), error_category() };
+    co_return;
+  }
+  const auto count = std::min<std::size_t>(buffers.size(), UIO_MAXIOV);
+  std::vector<endpoint> peers(count);
+  std::vector<iovec> vectors(count);
+  std::vector<segment_control> controls(count);
+  std::vector<mmsghdr> messages(count);
+  for (std::size_t i = 0; i < count; i++) {
+    vectors[i] = { buffers[i].data(), buffers[i].size() };
+    messages[i].msg_hdr.msg_name = peers[i].data();
+    messages[i].msg_hdr.msg_iov = &vectors[i];
+    messages[i].msg_hdr.msg_iovlen = 1;
+    messages[i].msg_hdr.msg_control = controls[i].data;
+  }
+  std::vector<datagram> batch;
+  batch.reserve(count);
+  event event(events_, descriptor_, handle_, EPOLLIN, timeout, token);
+  while (true) {
+    for (auto& message : messages) {
+      message.msg_hdr.msg_namelen = static_cast<socklen_t>(endpoint::capacity);
+      message.msg_hdr.msg_controllen = sizeof(segment_control::data);
+    }
+    const auto rv = ::recvmmsg(handle_, messages.data(), static_cast<unsigned>(count), 0, nullptr);
+    if (rv < 0) {
+      if (errno != EAGAIN) {
+        ec_ = { errno, error_category() };
+        co_return;
+      }
+      if (const auto ec = co_await event) {
+        ec_ = ec;
+        co_return;
+      }
+      continue;
+    }
+    batch.clear();
+    for (std::size_t i = 0; i < static_cast<std::size_t>(rv); i++) {
+      peers[i].resize(messages[i].msg_hdr.msg_namelen);
+      const std::string_view received(buffers[i].data(), messages[i].msg_len);
+      split(batch, peers[i], received, get_segment_size(messages[i].msg_hdr));
+    }
+    co_yield batch;
+  }
+  co_return;
+}
+
+async<std::error_code> socket::send(
+  std::string_view message, std::chrono::milliseconds timeout, cancellation_token token) noexcept {
   auto data = message.data();
   auto size = message.size();
-  event event(events_.get().value(), handle_, EPOLLOUT);
+  event event(events_, descriptor_, handle_, EPOLLOUT, timeout, token);
   while (size > 0) {
-    std::int64_t rv = ::write(handle_, data, size);
+    const std::int64_t rv = ::write(handle_, data, size);
     if (rv < 0) {
       if (errno != EAGAIN) {
         co_return { errno, error_category() };
       }
-      co_await event;
-      rv = ::write(handle_, data, size);
-      if (rv < 0) {
-        co_return{ errno, error_category() };
+      if (const auto ec = co_await event) {
+        co_return ec;
       }
+      continue;
     }
     if (rv == 0) {
       co_return { static_cast<int>(errc::eof), error_category() };
@@ -93,10 +314,341 @@ async<std::error_code> socket::send(std::string_view message) noexcept {
   co_return {};
 }
 
+async<std::error_code> socket::send(
+  const std::vector<std::string_view>& buffers, std::chrono::milliseconds timeout, cancellation_token token) noexcept {
+  // Short chains are stored in the coroutine frame.
+  std::array<iovec, 8> small;
+  std::vector<iovec> large;
+  if (buffers.size() > small.size()) {
+    large.resize(buffers.size());
+  }
+  auto vector = large.empty() ? small.data() : large.data();
+  std::size_t count = 0;
+  for (const auto buffer : buffers) {
+    if (!buffer.empty()) {
+      vector[count++] = { const_cast<char*>(buffer.data()), buffer.size() };
+    }
+  }
+  event event(events_, descriptor_, handle_, EPOLLOUT, timeout, token);
+  while (count > 0) {
+    const auto rv = send_vector(handle_, vector, count);
+    if (rv < 0) {
+      if (errno != EAGAIN) {
+        co_return { errno, error_category() };
+      }
+      if (const auto ec = co_await event) {
+        co_return ec;
+      }
+      continue;
+    }
+    if (rv == 0) {
+      co_return { static_cast<int>(errc::eof), error_category() };
+    }
+    auto bytes = static_cast<std::size_t>(rv);
+    while (count > 0 && bytes >= vector->iov_len) {
+      bytes -= vector->iov_len;
+      vector++;
+      count--;
+    }
+    if (count > 0) {
+      vector->iov_base = static_cast<char*>(vector->iov_base) + bytes;
+      vector->iov_len -= bytes;
+    }
+  }
+  co_return {};
+}
+
+async<std::error_code> socket::send_to(
+  const endpoint& peer, std::string_view message, std::chrono::milliseconds timeout,
+  cancellation_token token) noexcept {
+  const auto addr = peer.size() ? static_cast<const sockaddr*>(peer.data()) : nullptr;
+  const auto length = static_cast<socklen_t>(peer.size());
+  event event(events_, descriptor_, handle_, EPOLLOUT, timeout, token);
+  while (::sendto(handle_, message.data(), message.size(), MSG_NOSIGNAL, addr, length) < 0) {
+    if (errno != EAGAIN) {
+      co_return { errno, error_category() };
+    }
+    if (const auto ec = co_await event) {
+      co_return ec;
+    }
+  }
+  co_return {};
+}
+
+async<std::error_code> socket::send_segments(
+  const endpoint& peer, std::string_view message, std::size_t segment, std::chrono::milliseconds timeout,
+  cancellation_token token) noexcept {
+  if (segment == 0 || segment > max_segments_size) {
+    co_return { static_cast<int>(std::errc::invalid_argument), error_category() };
+  }
+  if (message.size() <= segment) {
+    co_return co_await send_to(peer, message, timeout, token);
+  }
+
+  // A single system call sends up to max_segments datagrams and max_segments_size bytes.
+  const auto chunk = segment * std::clamp<std::size_t>(max_segments_size / segment, 1, max_segments);
+  segment_control control;
+  struct iovec vector = {};
+  struct msghdr header = {};
+  header.msg_name = peer.size() ? const_cast<void*>(peer.data()) : nullptr;
+  header.msg_namelen = static_cast<socklen_t>(peer.size());
+  header.msg_iov = &vector;
+  header.msg_iovlen = 1;
+  event event(events_, descriptor_, handle_, EPOLLOUT, timeout, token);
+  while (!message.empty()) {
+    const auto size = std::min(message.size(), chunk);
+    vector = { const_cast<char*>(message.data()), size };
+    set_segment_size(header, control, static_cast<std::uint16_t>(segment));
+    if (::sendmsg(handle_, &header, MSG_NOSIGNAL) < 0) {
+      if (errno == EIO || errno == EINVAL || errno == ENOPROTOOPT) {
+        // The kernel or the network device does not support segmentation offload.
+        std::vector<datagram> datagrams;
+        split(datagrams, peer, message, segment);
+        co_return co_await send_to(datagrams, timeout, token);
+      }
+      if (errno != EAGAIN) {
+        co_return { errno, error_category() };
+      }
+      if (const auto ec = co_await event) {
+        co_return ec;
+      }
+      continue;
+    }
+    message.remove_prefix(size);
+  }
+  co_return {};
+}
+
+async<std::error_code> socket::send_to(
+  const std::vector<datagram>& datagrams, std::chrono::milliseconds timeout, cancellation_token token) noexcept {
+  std::vector<iovec> vectors(datagrams.size());
+  std::vector<mmsghdr> messages(datagrams.size());
+  for (std::size_t i = 0; i < datagrams.size(); i++) {
+    const auto& [peer, data] = datagrams[i];
+    vectors[i] = { const_cast<char*>(data.data()), data.size() };
+    messages[i].msg_hdr.msg_name = peer.size() ? const_cast<void*>(peer.data()) : nullptr;
+    messages[i].msg_hdr.msg_namelen = static_cast<socklen_t>(peer.size());
+    messages[i].msg_hdr.msg_iov = &vectors[i];
+    messages[i].msg_hdr.msg_iovlen = 1;
+  }
+  event event(events_, descriptor_, handle_, EPOLLOUT, timeout, token);
+  std::size_t sent = 0;
+  while (sent < messages.size()) {
+    const auto count = static_cast<unsigned>(std::min<std::size_t>(messages.size() - sent, UIO_MAXIOV));
+    const auto rv = ::sendmmsg(handle_, messages.data() + sent, count, MSG_NOSIGNAL);
+    if (rv < 0) {
+      if (errno != EAGAIN) {
+        co_return { errno, error_category() };
+      }
+      if (const auto ec = co_await event) {
+        co_return ec;
+      }
+      continue;
+    }
+    sent += static_cast<std::size_t>(rv);
+  }
+  co_return {};
+}
+
+async<std::error_code> socket::send_zerocopy(
+  std::string_view message, std::chrono::milliseconds timeout, cancellation_token token) noexcept {
+  if (message.size() < zerocopy_threshold) {
+    co_return co_await send(message, timeout, token);
+  }
+  if (!zerocopy_) {
+    auto value = 1;
+    if (::setsockopt(handle_, SOL_SOCKET, SO_ZEROCOPY, &value, sizeof(value)) < 0) {
+      co_return co_await send(message, timeout, token);
+    }
+    zerocopy_ = true;
+  }
+
+  // Every send call that accepts data is numbered by the kernel and reported in the error queue when it is released.
+  const auto first = zerocopy_id_;
+  auto data = message.data();
+  auto size = message.size();
+  std::error_code error;
+  event event(events_, descriptor_, handle_, EPOLLOUT, timeout, token);
+  while (size > 0) {
+    std::int64_t rv = ::send(handle_, data, size, MSG_ZEROCOPY | MSG_NOSIGNAL);
+    if (rv > 0) {
+      zerocopy_id_++;
+    } else if (rv < 0 && errno == ENOBUFS) {
+      // The kernel limits the memory used for pending notifications.
+      rv = ::send(handle_, data, size, MSG_NOSIGNAL);
+    }
+    if (rv < 0) {
+      if (errno != EAGAIN) {
+        error = { errno, error_category() };
+        break;
+      }
+      if (const auto ec = co_await event) {
+        error = ec;
+        break;
+      }
+      continue;
+    }
+    if (rv == 0) {
+      error = { static_cast<int>(errc::eof), error_category() };
+      break;
+    }
+    const auto bytes = static_cast<std::size_t>(rv);
+    data += bytes;
+    size -= bytes > size ? size : bytes;
+  }
+
+  // Wait until the kernel releases the message, even if sending failed after a part of it was sent.
+  // Notifications wake up the writer with EPOLLERR.
+  const auto count = zerocopy_id_ - first;
+  coronet::event notification(events_, descriptor_, handle_, EPOLLOUT);
+  for (std::uint32_t done = released(handle_); done < count; done += released(handle_)) {
+    if (const auto ec = co_await notification) {
+      co_return error ? error : ec;
+    }
+  }
+  co_return error;
+}
+
+async<std::error_code> socket::send_file(
+  int file, std::uint64_t offset, std::uint64_t size, std::chrono::milliseconds timeout,
+  cancellation_token token) noexcept {
+  struct stat st = {};
+  if (::fstat(file, &st) < 0) {
+    co_return { errno, error_category() };
+  }
+  constexpr std::uint64_t limit = std::numeric_limits<ssize_t>::max();
+  event event(events_, descriptor_, handle_, EPOLLOUT, timeout, token);
+
+  // Regular files are sent with sendfile.
+  if (S_ISREG(st.st_mode)) {
+    auto position = static_cast<off_t>(offset);
+    while (size > 0) {
+      const auto rv = ::sendfile(handle_, file, &position, static_cast<std::size_t>(std::min(size, limit)));
+      if (rv < 0) {
+        if (errno != EAGAIN) {
+          co_return { errno, error_category() };
+        }
+        if (const auto ec = co_await event) {
+          co_return ec;
+        }
+        continue;
+      }
+      if (rv == 0) {
+        break;
+      }
+      size -= static_cast<std::uint64_t>(rv);
+    }
+    co_return {};
+  }
+
+  // Other files are moved to the socket through a pipe with splice.
+  // The pipe is only filled when it is empty, so EAGAIN means that the file has no data or the socket is full.
+  pipe pipe;
+  if (const auto ec = pipe.create()) {
+    co_return ec;
+  }
+  descriptor* input = nullptr;
+  coronet::event readable(events_, input, file, EPOLLIN, timeout, token);
+  std::size_t buffered = 0;
+  std::error_code error;
+  while (buffered > 0 || size > 0) {
+    if (buffered == 0) {
+      const auto rv = ::splice(
+        file, nullptr, pipe.writer(), nullptr, static_cast<std::size_t>(std::min(size, limit)),
+        SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+      if (rv < 0) {
+        if (errno != EAGAIN) {
+          error = { errno, error_category() };
+          break;
+        }
+        if (const auto ec = co_await readable) {
+          error = ec;
+          break;
+        }
+        continue;
+      }
+      if (rv == 0) {
+        break;
+      }
+      buffered = static_cast<std::size_t>(rv);
+      size -= static_cast<std::uint64_t>(rv);
+    }
+    const auto rv = ::splice(pipe.reader(), nullptr, handle_, nullptr, buffered, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    if (rv < 0) {
+      if (errno != EAGAIN) {
+        error = { errno, error_category() };
+        break;
+      }
+      if (const auto ec = co_await event) {
+        error = ec;
+        break;
+      }
+      continue;
+    }
+    buffered -= static_cast<std::size_t>(rv);
+  }
+  if (const auto state = events_.get().data()) {
+    state->detach(file, input);
+  }
+  co_return error;
+}
+
+async<std::error_code> socket::splice(
+  socket& other, std::uint64_t& count, std::chrono::milliseconds timeout, cancellation_token token) noexcept {
+  pipe pipe;
+  if (const auto ec = pipe.create()) {
+    co_return ec;
+  }
+
+  // The pipe is only filled when it is empty, so EAGAIN means that the socket has no data or the other socket is full.
+  event readable(events_, descriptor_, handle_, EPOLLIN, timeout, token);
+  event writable(other.events_, other.descriptor_, other.handle_, EPOLLOUT, timeout, token);
+  constexpr std::size_t limit = std::numeric_limits<ssize_t>::max();
+  std::size_t buffered = 0;
+  while (true) {
+    if (buffered == 0) {
+      const auto rv = ::splice(handle_, nullptr, pipe.writer(), nullptr, limit, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+      if (rv < 0) {
+        if (errno != EAGAIN) {
+          co_return { errno, error_category() };
+        }
+        if (const auto ec = co_await readable) {
+          co_return ec;
+        }
+        continue;
+      }
+      if (rv == 0) {
+        if (::shutdown(other.handle_, SHUT_WR) < 0) {
+          co_return { errno, error_category() };
+        }
+        co_return {};
+      }
+      buffered = static_cast<std::size_t>(rv);
+    }
+    const auto rv =
+      ::splice(pipe.reader(), nullptr, other.handle_, nullptr, buffered, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    if (rv < 0) {
+      if (errno != EAGAIN) {
+        co_return { errno, error_category() };
+      }
+      if (const auto ec = co_await writable) {
+        co_return ec;
+      }
+      continue;
+    }
+    buffered -= static_cast<std::size_t>(rv);
+    count += static_cast<std::uint64_t>(rv);
+  }
+  co_return {};
+}
+
 // clang-format on
 
 std::error_code socket::close() noexcept {
   if (valid()) {
+    if (const auto state = events_.get().data()) {
+      state->detach(descriptor_);
+    }
     ::shutdown(handle_, SHUT_RDWR);
     if (::close(handle_) < 0) {
       return { errno, error_category() };
@@ -15,6 +15,7 @@ public:
     switch (static_cast<errc>(condition)) {
     case errc::eof: return "end of file";
     case errc::cancelled: return "cancelled";
+    case errc::closed: return "closed";
     }
     auto str = std::system_category().message(condition);
     std::transform(str.begin(), str.end(), str.begin(), [](char c) noexcept {
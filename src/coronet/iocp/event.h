@@ -1,14 +1,63 @@
 #pragma once
+#include <coronet/events.h>
+#include <coronet/queue.h>
+#include <coronet/wheel.h>
 #include <windows.h>
 #include <experimental/coroutine>
+#include <atomic>
+#include <chrono>
 
 namespace coronet {
 
+class events::state final {
+public:
+  explicit state(HANDLE events) noexcept : events_(events) {
+  }
+
+  state(state&& other) = delete;
+  state& operator=(state&& other) = delete;
+
+  ~state() = default;
+
+  // Requests events::run to return. Thread-safe.
+  void stop() noexcept {
+    stopped_.store(true, std::memory_order_release);
+    PostQueuedCompletionStatus(events_, 0, 0, nullptr);
+  }
+
+  // Queues the work item and wakes up events::run if the queue was empty. Thread-safe.
+  void post(work& work) noexcept {
+    if (queue_.push(work)) {
+      PostQueuedCompletionStatus(events_, 0, 0, nullptr);
+    }
+  }
+
+  // Handles a completion without an overlapped structure and calls posted work items.
+  // Returns true if events::run should return.
+  bool wakeup() noexcept {
+    queue_.run();
+    return stopped_.exchange(false, std::memory_order_acq_rel);
+  }
+
+  // Returns the timing wheel of the events queue.
+  wheel& timers() noexcept {
+    return timers_;
+  }
+
+private:
+  HANDLE events_ = nullptr;
+  std::atomic<bool> stopped_ = false;
+  work_queue queue_;
+  wheel timers_;
+};
+
 class event final : public OVERLAPPED {
 public:
   using handle_type = std::experimental::coroutine_handle<>;
 
-  event() noexcept : OVERLAPPED({}) {
+  event(
+    events& events, HANDLE file, std::chrono::milliseconds timeout = {}, cancellation_token token = {}) noexcept :
+    OVERLAPPED({}), events_(events), file_(file), timeout_(timeout), token_(token), deadline_(*this) {
   }
 
   event(event&& other) = delete;
@@ -17,12 +66,23 @@ public:
   event& operator=(event&& other) = delete;
   event& operator=(const event& other) = delete;
 
+  ~event() {
+    disarm();
+  }
+
   constexpr bool await_ready() noexcept {
     return ready_;
   }
 
   void await_suspend(handle_type handle) noexcept {
     handle_ = handle;
+    if (!token_.attach(deadline_)) {
+      deadline_();
+      return;
+    }
+    if (timeout_.count() > 0) {
+      events_.start(deadline_, timeout_);
+    }
   }
 
   constexpr auto await_resume() noexcept {
@@ -30,6 +90,7 @@ public:
   }
 
   void operator()(DWORD size) noexcept {
+    disarm();
     result_ = size;
     ready_ = true;
     if (auto handle = std::exchange(handle_, nullptr)) {
@@ -44,9 +105,38 @@ public:
   }
 
 private:
+  // Cancels the operation when the timeout expires or the token is cancelled.
+  // The operation completes with WSA_OPERATION_ABORTED unless it already completed.
+  class deadline final : public timer, public cancellation_callback {
+  public:
+    explicit deadline(event& event) noexcept : event_(event) {
+    }
+
+    void operator()() noexcept override {
+      event_.disarm();
+      CancelIoEx(event_.file_, &event_);
+    }
+
+  private:
+    event& event_;
+  };
+
+  // Cancels the timeout and unregisters the cancellation callback.
+  void disarm() noexcept {
+    if (deadline_.armed()) {
+      events_.cancel(deadline_);
+    }
+    deadline_.reset();
+  }
+
+  events& events_;
+  HANDLE file_ = nullptr;
   bool ready_ = false;
   DWORD result_ = 0;
   handle_type handle_ = nullptr;
+  std::chrono::milliseconds timeout_;
+  cancellation_token token_;
+  deadline deadline_;
 };
 
 }  // namespace coronet
@@ -1,9 +1,13 @@
 #include <coronet/events.h>
 #include <coronet/iocp/event.h>
+#include <coronet/thread.h>
 #include <windows.h>
 #include <winsock2.h>
 #include <ws2tcpip.h>
-#include <array>
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <vector>
 #include <cstdio>
 
 namespace coronet {
@@ -27,6 +31,10 @@ public:
 
 }  // namespace
 
+events::~events() {
+  delete state_;
+}
+
 std::error_code events::create() noexcept {
   // Initialize windows sockets.
   static library library;
@@ -36,6 +44,7 @@ std::error_code events::create() noexcept {
   if (!events) {
     return { static_cast<int>(GetLastError()), error_category() };
   }
+  events.state_ = new state(events.as<HANDLE>());
 
   // Replace current completion port.
   if (const auto ec = close()) {
@@ -45,21 +54,47 @@ std::error_code events::create() noexcept {
   return {};
 }
 
-std::error_code events::run(int processor) {
+std::error_code events::run(int processor, const policy& policy) {
   if (!valid()) {
     return { static_cast<int>(std::errc::bad_file_descriptor), error_category() };
   }
 
-  // Handle completed events.
+  // Pin the current thread to the given processor.
+  if (processor >= 0) {
+    if (const auto ec = set_affinity(processor)) {
+      return ec;
+    }
+  }
+
+  // Make the events queue available to coroutines that run on this thread.
+  const auto previous = std::exchange(current_, this);
+
+  // Handle completed events. Busy polling is not supported.
   std::error_code ec;
-  std::array<OVERLAPPED_ENTRY, 1024> events;
+  auto& state = *state_;
+  auto& timers = state.timers();
+  auto stopped = false;
+  std::vector<OVERLAPPED_ENTRY> events(std::max(policy.batch, std::size_t(1)));
+  const auto batch_max = std::min<std::size_t>(policy.batch_max, std::numeric_limits<ULONG>::max());
   const auto handle = as<HANDLE>();
-  const auto events_data = events.data();
-  const auto events_size = static_cast<ULONG>(events.size());
-  while (true) {
+  auto spin = std::chrono::steady_clock::time_point();
+  while (!stopped) {
     ULONG count = 0;
-    if (!GetQueuedCompletionStatusEx(handle, events_data, events_size, &count, INFINITE, FALSE)) {
-      if (const auto code = GetLastError(); code != ERROR_ABANDONED_WAIT_0) {
+    auto timeout = INFINITE;
+    if (const auto ticks = timers.timeout(); ticks != wheel::infinite) {
+      timeout = static_cast<DWORD>(std::min<std::uint64_t>(ticks, INFINITE - 1));
+    }
+    if (policy.spin.count() > 0 && std::chrono::steady_clock::now() < spin) {
+      timeout = 0;
+    }
+    const auto events_size = static_cast<ULONG>(events.size());
+    if (!GetQueuedCompletionStatusEx(handle, events.data(), events_size, &count, timeout, FALSE)) {
+      const auto code = GetLastError();
+      if (code == WAIT_TIMEOUT) {
+        timers.advance();
+        continue;
+      }
+      if (code != ERROR_ABANDONED_WAIT_0) {
         ec = { static_cast<int>(code), error_category() };
       }
       break;
@@ -69,12 +104,46 @@ std::error_code events::run(int processor) {
       if (ev.lpOverlapped) {
         auto& handler = *static_cast<event*>(ev.lpOverlapped);
         handler(ev.dwNumberOfBytesTransferred);
+      } else if (state.wakeup()) {
+        stopped = true;
       }
     }
+    if (count > 0 && policy.spin.count() > 0) {
+      spin = std::chrono::steady_clock::now() + policy.spin;
+    }
+    timers.advance();
+    if (count == events_size && events.size() < batch_max) {
+      events.resize(std::min<std::size_t>(events.size() * 2, batch_max));
+    }
   }
+  current_ = previous;
   return ec;
 }
 
+void events::stop() noexcept {
+  if (state_) {
+    state_->stop();
+  }
+}
+
+void events::start(timer& timer, std::chrono::milliseconds duration) noexcept {
+  if (state_) {
+    state_->timers().start(timer, duration);
+  }
+}
+
+void events::cancel(timer& timer) noexcept {
+  if (state_) {
+    state_->timers().cancel(timer);
+  }
+}
+
+void events::post(work& work) noexcept {
+  if (state_) {
+    state_->post(work);
+  }
+}
+
 std::error_code events::close() noexcept {
   if (valid()) {
     if (!CloseHandle(as<HANDLE>())) {
@@ -9,11 +9,16 @@
 
 namespace coronet {
 
-std::error_code server::create(const std::string& host, const std::string& port, type type) noexcept {
+std::error_code server::create(const std::string& host, const std::string& port, type type, bool reuseport) noexcept {
   if (!events_.get()) {
     return { static_cast<int>(std::errc::bad_file_descriptor), error_category() };
   }
 
+  // Windows does not distribute connections between sockets bound to the same address.
+  if (reuseport) {
+    return { static_cast<int>(std::errc::operation_not_supported), error_category() };
+  }
+
   // Convert host and port to socket address and options.
   address address;
   if (const auto ec = address.create(host, port, type, AI_PASSIVE)) {
@@ -55,7 +60,18 @@ std::error_code server::create(const std::string& host, const std::string& port,
   return {};
 }
 
-async_generator<socket> server::accept(std::size_t backlog) noexcept {
+std::error_code server::create(const server& other) noexcept {
+  // A socket can only be associated with a single completion port.
+  return { static_cast<int>(std::errc::operation_not_supported), error_category() };
+}
+
+std::error_code server::steer(const std::vector<int>& processors) noexcept {
+  // Reuseport programs are only supported on Linux.
+  return { static_cast<int>(std::errc::operation_not_supported), error_category() };
+}
+
+local_async_generator<socket> server::accept(
+  std::size_t backlog, std::chrono::milliseconds timeout, cancellation_token token) noexcept {
   constexpr DWORD salen = sizeof(struct sockaddr_storage) + 16;
   ec_.clear();
 
@@ -66,7 +82,7 @@ async_generator<socket> server::accept(std::size_t backlog) noexcept {
   }
 
   // Accept connections.
-  event event;
+  event event(events_, as<HANDLE>(), timeout, token);
   std::array<char, salen * 2> buffer;
   while (true) {
     // Create a socket that will receive the accepted connection.
@@ -94,7 +110,10 @@ async_generator<socket> server::accept(std::size_t backlog) noexcept {
     }
     bytes = co_await event;
     WSAGetOverlappedResult(as<SOCKET>(), &event, &bytes, FALSE, &flags);
-    if (const auto code = WSAGetLastError()) {
+    if (const auto code = WSAGetLastError(); code == WSA_OPERATION_ABORTED) {
+      ec_ = { static_cast<int>(errc::cancelled), error_category() };
+      co_return;
+    } else if (code) {
       ec_ = { code, error_category() };
       co_return;
     }
@@ -5,6 +5,9 @@
 #include <winsock2.h>
 #include <ws2tcpip.h>
 #include <mswsock.h>
+#include <algorithm>
+#include <array>
+#include <limits>
 
 namespace coronet {
 
@@ -29,24 +32,34 @@ std::error_code socket::create(family family, type type, int protocol) noexcept
 }
 
 std::error_code socket::set(option option, bool enable) noexcept {
+  auto level = 0;
   auto sockopt = 0;
   switch (option) {
-  case option::nodelay: sockopt = TCP_NODELAY; break;
+  case option::nodelay:
+    level = IPPROTO_TCP;
+    sockopt = TCP_NODELAY;
+    break;
+  case option::gro: return { static_cast<int>(std::errc::operation_not_supported), error_category() };
   }
   BOOL value = enable ? TRUE : FALSE;
   auto value_data = reinterpret_cast<const char*>(&value);
   auto value_size = static_cast<int>(sizeof(value));
-  if (::setsockopt(as<SOCKET>(), SOL_SOCKET, sockopt, value_data, value_size) == SOCKET_ERROR) {
+  if (::setsockopt(as<SOCKET>(), level, sockopt, value_data, value_size) == SOCKET_ERROR) {
     return { WSAGetLastError(), error_category() };
   }
   return {};
 }
 
+int socket::processor() const noexcept {
+  return -1;
+}
+
 // clang-format off
 
-async_generator<std::string_view> socket::recv(void* data, std::size_t size) noexcept {
+local_async_generator<std::string_view> socket::recv(
+  void* data, std::size_t size, std::chrono::milliseconds timeout, cancellation_token token) noexcept {
   ec_.clear();
-  event event;
+  event event(events_, as<HANDLE>(), timeout, token);
   WSABUF buffer = {};
   buffer.buf = reinterpret_cast<decltype(buffer.buf)>(data);
   buffer.len = static_cast<decltype(buffer.len)>(size);
@@ -62,7 +75,10 @@ async_generator<std::string_view> socket::recv(void* data, std::size_t size) noe
     }
     bytes = co_await event;
     WSAGetOverlappedResult(as<SOCKET>(), &event, &bytes, FALSE, &flags);
-    if (const auto code = WSAGetLastError()) {
+    if (const auto code = WSAGetLastError(); code == WSA_OPERATION_ABORTED) {
+      ec_ = { static_cast<int>(errc::cancelled), error_category() };
+      co_return;
+    } else if (code) {
       ec_ = { code, error_category() };
       co_return;
     }
@@ -76,8 +92,104 @@ async_generator<std::string_view> socket::recv(void* data, std::size_t size) noe
   co_return;
 }
 
-async<std::error_code> socket::send(std::string_view message) noexcept {
-  event event;
+local_async_generator<const std::vector<std::string_view>&> socket::recv(
+  std::vector<std::string>& buffers, std::chrono::milliseconds timeout, cancellation_token token) noexcept {
+  ec_.clear();
+  if (std::all_of(buffers.begin(), buffers.end(), [](const auto& buffer) { return buffer.empty(); })) {
+    ec_ = { static_cast<int>(std::errc::invalid_argument), error_category() };
+    co_return;
+  }
+  event event(events_, as<HANDLE>(), timeout, token);
+  std::vector<WSABUF> chain(buffers.size());
+  for (std::size_t i = 0; i < buffers.size(); i++) {
+    chain[i].buf = reinterpret_cast<decltype(chain[i].buf)>(buffers[i].data());
+    chain[i].len = static_cast<decltype(chain[i].len)>(buffers[i].size());
+  }
+  const auto count = static_cast<DWORD>(std::min<std::size_t>(chain.size(), std::numeric_limits<DWORD>::max()));
+  std::vector<std::string_view> batch;
+  batch.reserve(buffers.size());
+  while (true) {
+    // A single overlapped receive fills the buffers with all data that is available.
+    event.reset();
+    DWORD bytes = 0;
+    DWORD flags = 0;
+    if (WSARecv(as<SOCKET>(), chain.data(), count, &bytes, &flags, &event, nullptr) == SOCKET_ERROR) {
+      if (const auto code = WSAGetLastError(); code != ERROR_IO_PENDING) {
+        ec_ = { code, error_category() };
+        co_return;
+      }
+    }
+    bytes = co_await event;
+    WSAGetOverlappedResult(as<SOCKET>(), &event, &bytes, FALSE, &flags);
+    if (const auto code = WSAGetLastError(); code == WSA_OPERATION_ABORTED) {
+      ec_ = { static_cast<int>(errc::cancelled), error_category() };
+      co_return;
+    } else if (code) {
+      ec_ = { code, error_category() };
+      co_return;
+    }
+    if (!bytes) {
+      ec_ = { static_cast<int>(errc::eof), error_category() };
+      co_return;
+    }
+    batch.clear();
+    auto remaining = static_cast<std::size_t>(bytes);
+    for (std::size_t i = 0; i < buffers.size() && remaining > 0; i++) {
+      if (const auto size = std::min(remaining, buffers[i].size())) {
+        batch.emplace_back(buffers[i].data(), size);
+        remaining -= size;
+      }
+    }
+    co_yield batch;
+  }
+  co_return;
+}
+
+local_async_generator<const datagram&> socket::recv_from(
+  void* data, std::size_t size, std::chrono::milliseconds timeout, cancellation_token token) noexcept {
+  ec_.clear();
+  event event(events_, as<HANDLE>(), timeout, token);
+  WSABUF buffer = {};
+  buffer.buf = reinterpret_cast<decltype(buffer.buf)>(data);
+  buffer.len = static_cast<decltype(buffer.len)>(size);
+  datagram result;
+  while (true) {
+    event.reset();
+    DWORD bytes = 0;
+    DWORD flags = 0;
+    auto length = static_cast<INT>(endpoint::capacity);
+    const auto addr = static_cast<sockaddr*>(result.peer.data());
+    if (WSARecvFrom(as<SOCKET>(), &buffer, 1, &bytes, &flags, addr, &length, &event, nullptr) == SOCKET_ERROR) {
+      if (const auto code = WSAGetLastError(); code != ERROR_IO_PENDING && code != WSAEMSGSIZE) {
+        ec_ = { code, error_category() };
+        co_return;
+      }
+    }
+    bytes = co_await event;
+    WSAGetOverlappedResult(as<SOCKET>(), &event, &bytes, FALSE, &flags);
+    if (const auto code = WSAGetLastError(); code == WSA_OPERATION_ABORTED) {
+      ec_ = { static_cast<int>(errc::cancelled), error_category() };
+      co_return;
+    } else if (code && code != WSAEMSGSIZE) {
+      ec_ = { code, error_category() };
+      co_return;
+    }
+    result.peer.resize(static_cast<std::size_t>(length));
+    result.data = { reinterpret_cast<const char*>(data), bytes };
+    co_yield result;
+  }
+  co_return;
+}
+
+local_async_generator<const std::vector<datagram>&> socket::recv_from(
+  std::vector<std::string>& buffers, std::chrono::milliseconds timeout, cancellation_token token) noexcept {
+  ec_ = { static_cast<int>(std::errc::operation_not_supported), error_category() };
+  co_return;
+}
+
+async<std::error_code> socket::send(
+  std::string_view message, std::chrono::milliseconds timeout, cancellation_token token) noexcept {
+  event event(events_, as<HANDLE>(), timeout, token);
   WSABUF data = {};
   data.buf = reinterpret_cast<decltype(data.buf)>(const_cast<char*>(message.data()));
   data.len = static_cast<decltype(data.len)>(message.size());
@@ -92,7 +204,9 @@ async<std::error_code> socket::send(std::string_view message) noexcept {
     bytes = co_await event;
     DWORD flags = 0;
     WSAGetOverlappedResult(as<SOCKET>(), &event, &bytes, FALSE, &flags);
-    if (const auto code = WSAGetLastError()) {
+    if (const auto code = WSAGetLastError(); code == WSA_OPERATION_ABORTED) {
+      co_return std::error_code(static_cast<int>(errc::cancelled), error_category());
+    } else if (code) {
       co_return std::error_code(code, error_category());
     }
     if (!bytes) {
@@ -104,6 +218,128 @@ async<std::error_code> socket::send(std::string_view message) noexcept {
   co_return std::error_code{};
 }
 
+async<std::error_code> socket::send(
+  const std::vector<std::string_view>& buffers, std::chrono::milliseconds timeout, cancellation_token token) noexcept {
+  // Short chains are stored in the coroutine frame.
+  std::array<WSABUF, 8> small;
+  std::vector<WSABUF> large;
+  if (buffers.size() > small.size()) {
+    large.resize(buffers.size());
+  }
+  auto chain = large.empty() ? small.data() : large.data();
+  std::size_t count = 0;
+  for (const auto buffer : buffers) {
+    if (!buffer.empty()) {
+      chain[count].buf = reinterpret_cast<decltype(chain[count].buf)>(const_cast<char*>(buffer.data()));
+      chain[count].len = static_cast<decltype(chain[count].len)>(buffer.size());
+      count++;
+    }
+  }
+  event event(events_, as<HANDLE>(), timeout, token);
+  while (count > 0) {
+    event.reset();
+    DWORD bytes = 0;
+    const auto size = static_cast<DWORD>(std::min<std::size_t>(count, std::numeric_limits<DWORD>::max()));
+    if (WSASend(as<SOCKET>(), chain, size, &bytes, 0, &event, nullptr) == SOCKET_ERROR) {
+      if (const auto code = WSAGetLastError(); code != ERROR_IO_PENDING) {
+        co_return std::error_code(code, error_category());
+      }
+    }
+    bytes = co_await event;
+    DWORD flags = 0;
+    WSAGetOverlappedResult(as<SOCKET>(), &event, &bytes, FALSE, &flags);
+    if (const auto code = WSAGetLastError(); code == WSA_OPERATION_ABORTED) {
+      co_return std::error_code(static_cast<int>(errc::cancelled), error_category());
+    } else if (code) {
+      co_return std::error_code(code, error_category());
+    }
+    if (!bytes) {
+      co_return std::error_code(static_cast<int>(errc::eof), error_category());
+    }
+    while (count > 0 && bytes >= chain->len) {
+      bytes -= chain->len;
+      chain++;
+      count--;
+    }
+    if (count > 0) {
+      chain->buf += bytes;
+      chain->len -= bytes;
+    }
+  }
+  co_return std::error_code{};
+}
+
+async<std::error_code> socket::send_to(
+  const endpoint& peer, std::string_view message, std::chrono::milliseconds timeout,
+  cancellation_token token) noexcept {
+  event event(events_, as<HANDLE>(), timeout, token);
+  WSABUF data = {};
+  data.buf = reinterpret_cast<decltype(data.buf)>(const_cast<char*>(message.data()));
+  data.len = static_cast<decltype(data.len)>(message.size());
+  const auto addr = peer.size() ? static_cast<const sockaddr*>(peer.data()) : nullptr;
+  const auto length = static_cast<int>(peer.size());
+  DWORD bytes = 0;
+  if (WSASendTo(as<SOCKET>(), &data, 1, &bytes, 0, addr, length, &event, nullptr) == SOCKET_ERROR) {
+    if (const auto code = WSAGetLastError(); code != ERROR_IO_PENDING) {
+      co_return std::error_code(code, error_category());
+    }
+  }
+  bytes = co_await event;
+  DWORD flags = 0;
+  WSAGetOverlappedResult(as<SOCKET>(), &event, &bytes, FALSE, &flags);
+  if (const auto code = WSAGetLastError(); code == WSA_OPERATION_ABORTED) {
+    co_return std::error_code(static_cast<int>(errc::cancelled), error_category());
+  } else if (code) {
+    co_return std::error_code(code, error_category());
+  }
+  co_return std::error_code{};
+}
+
+async<std::error_code> socket::send_segments(
+  const endpoint& peer, std::string_view message, std::size_t segment, std::chrono::milliseconds timeout,
+  cancellation_token token) noexcept {
+  if (segment == 0) {
+    co_return std::error_code(static_cast<int>(std::errc::invalid_argument), error_category());
+  }
+
+  // There is no segmentation offload, so the datagrams are sent one at a time.
+  do {
+    if (const auto ec = co_await send_to(peer, message.substr(0, segment), timeout, token)) {
+      co_return ec;
+    }
+    message.remove_prefix(std::min(message.size(), segment));
+  } while (!message.empty());
+  co_return std::error_code{};
+}
+
+async<std::error_code> socket::send_to(
+  const std::vector<datagram>& datagrams, std::chrono::milliseconds timeout, cancellation_token token) noexcept {
+  // There is no batched send, so the datagrams are sent one at a time.
+  for (const auto& [peer, data] : datagrams) {
+    if (const auto ec = co_await send_to(peer, data, timeout, token)) {
+      co_return ec;
+    }
+  }
+  co_return std::error_code{};
+}
+
+async<std::error_code> socket::send_zerocopy(
+  std::string_view message, std::chrono::milliseconds timeout, cancellation_token token) noexcept {
+  // Zero-copy sends are not supported.
+  co_return co_await send(message, timeout, token);
+}
+
+async<std::error_code> socket::send_file(
+  int file, std::uint64_t offset, std::uint64_t size, std::chrono::milliseconds timeout,
+  cancellation_token token) noexcept {
+  co_return { static_cast<int>(std::errc::operation_not_supported), error_category() };
+}
+
+async<std::error_code> socket::splice(
+  socket& other, std::uint64_t& count, std::chrono::milliseconds timeout, cancellation_token token) noexcept {
+  co_return { static_cast<int>(std::errc::operation_not_supported), error_category() };
+}
+
 // clang-format on
 
 std::error_code socket::close() noexcept {
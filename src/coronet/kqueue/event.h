@@ -1,15 +1,104 @@
 #pragma once
+#include <coronet/error.h>
+#include <coronet/events.h>
+#include <coronet/queue.h>
+#include <coronet/wheel.h>
 #include <sys/event.h>
 #include <experimental/coroutine>
+#include <atomic>
+#include <chrono>
+#include <utility>
+#include <cerrno>
 #include <cstddef>
 
 namespace coronet {
 
+class events::state final {
+public:
+  explicit state(int events) noexcept : events_(events) {
+  }
+
+  state(state&& other) = delete;
+  state& operator=(state&& other) = delete;
+
+  ~state() = default;
+
+  // Registers the user event that wakes up events::run from other threads.
+  std::error_code create() noexcept {
+    struct ::kevent ev;
+    EV_SET(&ev, 0, EVFILT_USER, EV_ADD | EV_CLEAR, 0, 0, nullptr);
+    if (::kevent(events_, &ev, 1, nullptr, 0, nullptr) < 0) {
+      return { errno, error_category() };
+    }
+    return {};
+  }
+
+  // Requests events::run to return. Thread-safe and async-signal-safe.
+  void stop() noexcept {
+    stopped_.store(true, std::memory_order_release);
+    notify();
+  }
+
+  // Queues the work item and wakes up events::run if the queue was empty. Thread-safe and async-signal-safe.
+  void post(work& work) noexcept {
+    if (queue_.push(work)) {
+      notify();
+    }
+  }
+
+  // Handles a wakeup notification and calls posted work items. Returns true if events::run should return.
+  bool wakeup() noexcept {
+    queue_.run();
+    return stopped_.exchange(false, std::memory_order_acq_rel);
+  }
+
+  // Returns the timing wheel of the events queue.
+  wheel& timers() noexcept {
+    return timers_;
+  }
+
+  // Sets the batch of kernel events that events::run is handling.
+  void dispatch(struct ::kevent* batch, std::size_t size) noexcept {
+    batch_ = batch;
+    batch_size_ = size;
+  }
+
+  // Deletes the filter of a waiting event and drops its entries from the batch that is being handled.
+  // The event can be destroyed as soon as this function returns.
+  void remove(struct ::kevent& event) noexcept {
+    struct ::kevent ev = event;
+    ev.flags = EV_DELETE;
+    ::kevent(events_, &ev, 1, nullptr, 0, nullptr);
+    for (std::size_t i = 0; i < batch_size_; i++) {
+      if (batch_[i].udata == event.udata) {
+        batch_[i].udata = nullptr;
+      }
+    }
+  }
+
+private:
+  void notify() noexcept {
+    struct ::kevent ev;
+    EV_SET(&ev, 0, EVFILT_USER, 0, NOTE_TRIGGER, 0, nullptr);
+    ::kevent(events_, &ev, 1, nullptr, 0, nullptr);
+  }
+
+  int events_ = -1;
+  std::atomic<bool> stopped_ = false;
+  work_queue queue_;
+  wheel timers_;
+  struct ::kevent* batch_ = nullptr;
+  std::size_t batch_size_ = 0;
+};
+
 class event final : public kevent {
 public:
   using handle_type = std::experimental::coroutine_handle<>;
 
-  event(int events, int socket, short filter) noexcept : kevent({}), events_(events) {
+  event(
+    events& events, int socket, short filter, std::chrono::milliseconds timeout = {},
+    cancellation_token token = {}) noexcept :
+    kevent({}), events_(events), timeout_(timeout), token_(token), deadline_(*this) {
     const auto ev = static_cast<struct ::kevent*>(this);
     const auto ident = static_cast<uintptr_t>(socket);
     EV_SET(ev, ident, filter, EV_ADD | EV_ONESHOT, 0, 0, this);
@@ -18,15 +107,27 @@ public:
   event(event&& event) = delete;
   event& operator=(event&& other) = delete;
 
-  ~event() = default;
+  ~event() {
+    disarm();
+    remove();
+  }
 
   constexpr bool await_ready() noexcept {
     return false;
   }
 
-  void await_suspend(handle_type handle) noexcept {
+  bool await_suspend(handle_type handle) noexcept {
+    if (!token_.attach(deadline_)) {
+      result_ = -1;
+      return false;
+    }
     handle_ = handle;
-    ::kevent(events_, this, 1, nullptr, 0, nullptr);
+    ::kevent(events_.value(), this, 1, nullptr, 0, nullptr);
+    waiting_ = true;
+    if (timeout_.count() > 0) {
+      events_.start(deadline_, timeout_);
+    }
+    return true;
   }
 
   constexpr auto await_resume() noexcept {
@@ -34,14 +135,55 @@ public:
   }
 
   void operator()(std::int64_t result) noexcept {
+    waiting_ = false;
+    disarm();
     result_ = result;
     handle_.resume();
   }
 
 private:
+  // Removes the filter and completes the wait with a negative result
+  // when the timeout expires or the token is cancelled.
+  class deadline final : public timer, public cancellation_callback {
+  public:
+    explicit deadline(event& event) noexcept : event_(event) {
+    }
+
+    void operator()() noexcept override {
+      event_.disarm();
+      event_.remove();
+      event_.result_ = -1;
+      event_.handle_.resume();
+    }
+
+  private:
+    event& event_;
+  };
+
+  // Cancels the timeout and unregisters the cancellation callback.
+  void disarm() noexcept {
+    if (deadline_.armed()) {
+      events_.cancel(deadline_);
+    }
+    deadline_.reset();
+  }
+
+  // Stops waiting for the filter. A cancelled or destroyed event can already be in the current batch.
+  void remove() noexcept {
+    if (std::exchange(waiting_, false)) {
+      if (const auto state = events_.data()) {
+        state->remove(*this);
+      }
+    }
+  }
+
+  events& events_;
   std::int64_t result_ = 0;
   handle_type handle_ = nullptr;
-  int events_ = -1;
+  std::chrono::milliseconds timeout_;
+  cancellation_token token_;
+  deadline deadline_;
+  bool waiting_ = false;
 };
 
 }  // namespace coronet
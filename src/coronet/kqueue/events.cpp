@@ -1,17 +1,30 @@
 #include <coronet/events.h>
 #include <coronet/kqueue/event.h>
+#include <coronet/thread.h>
 #include <unistd.h>
-#include <array>
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <vector>
 #include <cerrno>
+#include <ctime>
 
 namespace coronet {
 
+events::~events() {
+  delete state_;
+}
+
 std::error_code events::create() noexcept {
   // Create a new kqueue handle.
   events events(::kqueue());
   if (!events) {
     return { errno, error_category() };
   }
+  events.state_ = new state(events.value());
+  if (const auto ec = events.state_->create()) {
+    return ec;
+  }
 
   // Replace current kqueue handle.
   if (const auto ec = close()) {
@@ -21,35 +34,99 @@ std::error_code events::create() noexcept {
   return {};
 }
 
-std::error_code events::run(int processor) {
+std::error_code events::run(int processor, const policy& policy) {
   if (!valid()) {
     return { static_cast<int>(std::errc::bad_file_descriptor), error_category() };
   }
 
-  // Handle completed events.
+  // Pin the current thread to the given processor.
+  if (processor >= 0) {
+    if (const auto ec = set_affinity(processor)) {
+      return ec;
+    }
+  }
+
+  // Make the events queue available to coroutines that run on this thread.
+  const auto previous = std::exchange(current_, this);
+
+  // Handle completed events. Busy polling is not supported.
   std::error_code ec;
-  std::array<struct ::kevent, 32> events;
-  const auto events_data = events.data();
-  const auto events_size = events.size();
-  while (true) {
-    const auto count = ::kevent(handle_, nullptr, 0, events_data, events_size, nullptr);
+  auto& state = *state_;
+  auto stopped = false;
+  std::vector<struct ::kevent> events(std::max(policy.batch, std::size_t(1)));
+  const auto batch_max = std::min<std::size_t>(policy.batch_max, std::numeric_limits<int>::max());
+  auto& timers = state.timers();
+  auto spin = std::chrono::steady_clock::time_point();
+  while (!stopped) {
+    struct timespec ts = {};
+    auto timeout = static_cast<struct timespec*>(nullptr);
+    if (const auto ticks = timers.timeout(); ticks != wheel::infinite) {
+      ts.tv_sec = static_cast<time_t>(ticks / 1000);
+      ts.tv_nsec = static_cast<long>(ticks % 1000 * 1000000);
+      timeout = &ts;
+    }
+    if (policy.spin.count() > 0 && std::chrono::steady_clock::now() < spin) {
+      ts = {};
+      timeout = &ts;
+    }
+    const auto events_size = static_cast<int>(events.size());
+    const auto count = ::kevent(handle_, nullptr, 0, events.data(), events_size, timeout);
     if (count < 0) {
-      if (errno != EINTR) {
-        ec = { errno, error_category() };
+      // Signal handlers stop the events queue with events::stop.
+      if (errno == EINTR) {
+        continue;
       }
+      ec = { errno, error_category() };
       break;
     }
+    if (count > 0 && policy.spin.count() > 0) {
+      spin = std::chrono::steady_clock::now() + policy.spin;
+    }
+    // Events that are cancelled or destroyed while the batch is handled are removed from it.
+    state.dispatch(events.data(), static_cast<std::size_t>(count));
     for (std::size_t i = 0, max = static_cast<std::size_t>(count); i < max; i++) {
       const auto& ev = events[i];
       if (ev.udata) {
         auto& handler = *static_cast<event*>(ev.udata);
         handler(ev.data);
+      } else if (ev.filter == EVFILT_USER && state.wakeup()) {
+        stopped = true;
       }
     }
+    state.dispatch(nullptr, 0);
+    timers.advance();
+    if (count == events_size && events.size() < batch_max) {
+      events.resize(std::min(events.size() * 2, batch_max));
+    }
   }
+  current_ = previous;
   return ec;
 }
 
+void events::stop() noexcept {
+  if (state_) {
+    state_->stop();
+  }
+}
+
+void events::start(timer& timer, std::chrono::milliseconds duration) noexcept {
+  if (state_) {
+    state_->timers().start(timer, duration);
+  }
+}
+
+void events::cancel(timer& timer) noexcept {
+  if (state_) {
+    state_->timers().cancel(timer);
+  }
+}
+
+void events::post(work& work) noexcept {
+  if (state_) {
+    state_->post(work);
+  }
+}
+
 std::error_code events::close() noexcept {
   if (valid()) {
     if (::close(handle_) < 0) {
@@ -3,10 +3,11 @@
 #include <coronet/kqueue/event.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <unistd.h>
 
 namespace coronet {
 
-std::error_code server::create(const std::string& host, const std::string& port, type type) noexcept {
+std::error_code server::create(const std::string& host, const std::string& port, type type, bool reuseport) noexcept {
   if (!events_.get()) {
     return { static_cast<int>(std::errc::bad_file_descriptor), error_category() };
   }
@@ -29,6 +30,19 @@ std::error_code server::create(const std::string& host, const std::string& port,
     return { errno, error_category() };
   }
 
+  // Set SO_REUSEPORT_LB socket option where available, because SO_REUSEPORT does not balance connections on FreeBSD.
+  if (reuseport) {
+#ifdef SO_REUSEPORT_LB
+    constexpr auto reuseport_option = SO_REUSEPORT_LB;
+#else
+    constexpr auto reuseport_option = SO_REUSEPORT;
+#endif
+    auto value = 1;
+    if (::setsockopt(server.value(), SOL_SOCKET, reuseport_option, &value, sizeof(value)) < 0) {
+      return { errno, error_category() };
+    }
+  }
+
   // Bind listening socket to the given address.
   if (::bind(server.value(), address.addr(), address.addrlen()) < 0) {
     return { errno, error_category() };
@@ -45,7 +59,35 @@ std::error_code server::create(const std::string& host, const std::string& port,
   return {};
 }
 
-async_generator<socket> server::accept(std::size_t backlog) noexcept {
+std::error_code server::create(const server& other) noexcept {
+  if (!events_.get()) {
+    return { static_cast<int>(std::errc::bad_file_descriptor), error_category() };
+  }
+
+  // Duplicate listening socket.
+  server server(events_, ::dup(other.value()));
+  if (!server) {
+    return { errno, error_category() };
+  }
+
+  // Replace current socket.
+  if (const auto ec = close()) {
+    return ec;
+  }
+  *this = std::move(server);
+  protocol_ = other.protocol_;
+  family_ = other.family_;
+  type_ = other.type_;
+  return {};
+}
+
+std::error_code server::steer(const std::vector<int>& processors) noexcept {
+  // Reuseport programs are only supported on Linux.
+  return { static_cast<int>(std::errc::operation_not_supported), error_category() };
+}
+
+local_async_generator<socket> server::accept(
+  std::size_t backlog, std::chrono::milliseconds timeout, cancellation_token token) noexcept {
   ec_.clear();
 
   // Start listening on the socket.
@@ -57,7 +99,7 @@ async_generator<socket> server::accept(std::size_t backlog) noexcept {
   // Accept connections.
   struct sockaddr_storage storage;
   auto addr = reinterpret_cast<struct sockaddr*>(&storage);
-  event event(events_.get().value(), handle_, EVFILT_READ);
+  event event(events_, handle_, EVFILT_READ, timeout, token);
   while (true) {
     auto socklen = static_cast<socklen_t>(sizeof(storage));
     socket socket(events_, ::accept4(handle_, addr, &socklen, SOCK_NONBLOCK));
@@ -66,20 +108,12 @@ async_generator<socket> server::accept(std::size_t backlog) noexcept {
         ec_ = { errno, error_category() };
         co_return;
       }
-      const auto available = co_await event;
-      if (available < 0) {
+      // Another events queue can accept the connection first when the listening socket is shared.
+      if (co_await event < 0) {
         ec_ = { static_cast<int>(errc::cancelled), error_category() };
         co_return;
       }
-      if (available == 0) {
-        ec_ = { static_cast<int>(errc::eof), error_category() };
-        co_return;
-      }
-      socket.reset(::accept4(handle_, addr, &socklen, SOCK_NONBLOCK));
-      if (!socket) {
-        ec_ = { static_cast<int>(errc::eof), error_category() };
-        co_return;
-      }
+      continue;
     }
     co_yield socket;
   }
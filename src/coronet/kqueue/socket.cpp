@@ -2,10 +2,25 @@
 #include <coronet/address.h>
 #include <coronet/kqueue/event.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/tcp.h>
 #include <unistd.h>
+#include <algorithm>
+#include <array>
+#include <climits>
 
 namespace coronet {
+namespace {
+
+// Sends the buffers with sendmsg, which unlike writev does not raise SIGPIPE when the peer closed the connection.
+ssize_t send_vector(int socket, iovec* vector, std::size_t count) noexcept {
+  struct msghdr message = {};
+  message.msg_iov = vector;
+  message.msg_iovlen = static_cast<decltype(message.msg_iovlen)>(std::min<std::size_t>(count, IOV_MAX));
+  return ::sendmsg(socket, &message, MSG_NOSIGNAL);
+}
+
+}  // namespace
 
 std::error_code socket::create(family family, type type, int protocol) noexcept {
   if (!events_.get()) {
@@ -27,22 +42,32 @@ std::error_code socket::create(family family, type type, int protocol) noexcept
 }
 
 std::error_code socket::set(option option, bool enable) noexcept {
+  auto level = 0;
   auto sockopt = 0;
   switch (option) {
-  case option::nodelay: sockopt = TCP_NODELAY; break;
+  case option::nodelay:
+    level = IPPROTO_TCP;
+    sockopt = TCP_NODELAY;
+    break;
+  case option::gro: return { static_cast<int>(std::errc::operation_not_supported), error_category() };
   }
   auto value = enable ? 1 : 0;
-  if (::setsockopt(handle_, SOL_SOCKET, sockopt, &value, sizeof(value)) < 0) {
+  if (::setsockopt(handle_, level, sockopt, &value, sizeof(value)) < 0) {
     return { errno, error_category() };
   }
   return {};
 }
 
+int socket::processor() const noexcept {
+  return -1;
+}
+
 // clang-format off
 
-async_generator<std::string_view> socket::recv(void* data, std::size_t size) noexcept {
+local_async_generator<std::string_view> socket::recv(
+  void* data, std::size_t size, std::chrono::milliseconds timeout, cancellation_token token) noexcept {
   ec_.clear();
-  event event(events_.get().value(), handle_, EVFILT_READ);
+  event event(events_, handle_, EVFILT_READ, timeout, token);
   while (true) {
     std::int64_t rv = ::read(handle_, data, size);
     if (rv < 0) {
@@ -75,10 +100,159 @@ async_generator<std::string_view> socket::recv(void* data, std::size_t size) noe
   co_return;
 }
 
-async<std::error_code> socket::send(std::string_view message) noexcept {
+local_async_generator<const std::vector<std::string_view>&> socket::recv(
+  std::vector<std::string>& buffers, std::chrono::milliseconds timeout, cancellation_token token) noexcept {
+  ec_.clear();
+  if (std::all_of(buffers.begin(), buffers.end(), [](const auto& buffer) { return buffer.empty(); })) {
+    ec_ = { static_cast<int>(std::errc::invalid_argument), error_category() };
+    co_return;
+  }
+  event event(events_, handle_, EVFILT_READ, timeout, token);
+  std::vector<iovec> chain(buffers.size());
+  std::vector<std::string_view> batch;
+  batch.reserve(buffers.size());
+  while (true) {
+    // Read until the socket has no more data or all buffers are full.
+    for (std::size_t i = 0; i < buffers.size(); i++) {
+      chain[i] = { buffers[i].data(), buffers[i].size() };
+    }
+    auto vector = chain.data();
+    auto count = chain.size();
+    std::error_code error;
+    while (count > 0) {
+      const auto rv = ::readv(handle_, vector, static_cast<int>(std::min<std::size_t>(count, IOV_MAX)));
+      if (rv < 0) {
+        if (errno != EAGAIN) {
+          error = { errno, error_category() };
+        }
+        break;
+      }
+      if (rv == 0) {
+        error = { static_cast<int>(errc::eof), error_category() };
+        break;
+      }
+      auto bytes = static_cast<std::size_t>(rv);
+      while (count > 0 && bytes >= vector->iov_len) {
+        bytes -= vector->iov_len;
+        vector->iov_len = 0;
+        vector++;
+        count--;
+      }
+      if (count > 0) {
+        vector->iov_base = static_cast<char*>(vector->iov_base) + bytes;
+        vector->iov_len -= bytes;
+      }
+    }
+
+    // Yield received data before reporting errors.
+    batch.clear();
+    for (std::size_t i = 0; i < buffers.size(); i++) {
+      if (const auto size = buffers[i].size() - chain[i].iov_len) {
+        batch.emplace_back(buffers[i].data(), size);
+      }
+    }
+    if (!batch.empty()) {
+      co_yield batch;
+    }
+    if (error) {
+      ec_ = error;
+      co_return;
+    }
+    if (batch.empty()) {
+      const auto available = co_await event;
+      if (available < 0) {
+        ec_ = { static_cast<int>(errc::cancelled), error_category() };
+        co_return;
+      }
+      if (available == 0) {
+        ec_ = { static_cast<int>(errc::eof), error_category() };
+        co_return;
+      }
+    }
+  }
+  co_return;
+}
+
+local_async_generator<const datagram&> socket::recv_from(
+  void* data, std::size_t size, std::chrono::milliseconds timeout, cancellation_token token) noexcept {
+  ec_.clear();
+  event event(events_, handle_, EVFILT_READ, timeout, token);
+  datagram result;
+  while (true) {
+    auto length = static_cast<socklen_t>(endpoint::capacity);
+    const auto addr = static_cast<sockaddr*>(result.peer.data());
+    const std::int64_t rv = ::recvfrom(handle_, data, size, 0, addr, &length);
+    if (rv < 0) {
+      if (errno != EAGAIN) {
+        ec_ = { errno, error_category() };
+        co_return;
+      }
+      if (co_await event < 0) {
+        ec_ = { static_cast<int>(errc::cancelled), error_category() };
+        co_return;
+      }
+      continue;
+    }
+    result.peer.resize(length);
+    result.data = { reinterpret_cast<const char*>(data), static_cast<std::size_t>(rv) };
+    co_yield result;
+  }
+  co_return;
+}
+
+local_async_generator<const std::vector<datagram>&> socket::recv_from(
+  std::vector<std::string>& buffers, std::chrono::milliseconds timeout, cancellation_token token) noexcept {
+  ec_.clear();
+  if (buffers.empty()) {
+    ec_ = { static_cast<int>(std::errc::invalid_argument), error_category() };
+    co_return;
+  }
+  event event(events_, handle_, EVFILT_READ, timeout, token);
+  std::vector<datagram> batch;
+  batch.reserve(buffers.size());
+  while (true) {
+    // There is no portable batched receive, so datagrams are read until the socket has no more data or all buffers
+    // are full.
+    std::error_code error;
+    batch.clear();
+    while (batch.size() < buffers.size()) {
+      auto& buffer = buffers[batch.size()];
+      datagram result;
+      auto length = static_cast<socklen_t>(endpoint::capacity);
+      const auto addr = static_cast<sockaddr*>(result.peer.data());
+      const auto rv = ::recvfrom(handle_, buffer.data(), buffer.size(), 0, addr, &length);
+      if (rv < 0) {
+        if (errno != EAGAIN) {
+          error = { errno, error_category() };
+        }
+        break;
+      }
+      result.peer.resize(length);
+      result.data = { buffer.data(), static_cast<std::size_t>(rv) };
+      batch.push_back(result);
+    }
+
+    // Yield received data before reporting errors.
+    if (!batch.empty()) {
+      co_yield batch;
+    }
+    if (error) {
+      ec_ = error;
+      co_return;
+    }
+    if (batch.empty() && co_await event < 0) {
+      ec_ = { static_cast<int>(errc::cancelled), error_category() };
+      co_return;
+    }
+  }
+  co_return;
+}
+
+async<std::error_code> socket::send(
+  std::string_view message, std::chrono::milliseconds timeout, cancellation_token token) noexcept {
   auto data = message.data();
   auto size = message.size();
-  event event(events_.get().value(), handle_, EVFILT_WRITE);
+  event event(events_, handle_, EVFILT_WRITE, timeout, token);
   while (size > 0) {
     std::int64_t rv = ::write(handle_, data, size);
     if (rv < 0) {
@@ -107,6 +281,119 @@ async<std::error_code> socket::send(std::string_view message) noexcept {
   co_return {};
 }
 
+async<std::error_code> socket::send(
+  const std::vector<std::string_view>& buffers, std::chrono::milliseconds timeout, cancellation_token token) noexcept {
+  // Short chains are stored in the coroutine frame.
+  std::array<iovec, 8> small;
+  std::vector<iovec> large;
+  if (buffers.size() > small.size()) {
+    large.resize(buffers.size());
+  }
+  auto vector = large.empty() ? small.data() : large.data();
+  std::size_t count = 0;
+  for (const auto buffer : buffers) {
+    if (!buffer.empty()) {
+      vector[count++] = { const_cast<char*>(buffer.data()), buffer.size() };
+    }
+  }
+  event event(events_, handle_, EVFILT_WRITE, timeout, token);
+  while (count > 0) {
+    auto rv = send_vector(handle_, vector, count);
+    if (rv < 0) {
+      if (errno != EAGAIN) {
+        co_return { errno, error_category() };
+      }
+      const auto available = co_await event;
+      if (available < 0) {
+        co_return { static_cast<int>(errc::cancelled), error_category() };
+      }
+      if (available == 0) {
+        co_return { static_cast<int>(errc::eof), error_category() };
+      }
+      rv = send_vector(handle_, vector, count);
+      if (rv < 0) {
+        co_return { errno, error_category() };
+      }
+    }
+    if (rv == 0) {
+      co_return { static_cast<int>(errc::eof), error_category() };
+    }
+    auto bytes = static_cast<std::size_t>(rv);
+    while (count > 0 && bytes >= vector->iov_len) {
+      bytes -= vector->iov_len;
+      vector++;
+      count--;
+    }
+    if (count > 0) {
+      vector->iov_base = static_cast<char*>(vector->iov_base) + bytes;
+      vector->iov_len -= bytes;
+    }
+  }
+  co_return {};
+}
+
+async<std::error_code> socket::send_to(
+  const endpoint& peer, std::string_view message, std::chrono::milliseconds timeout,
+  cancellation_token token) noexcept {
+  const auto addr = peer.size() ? static_cast<const sockaddr*>(peer.data()) : nullptr;
+  const auto length = static_cast<socklen_t>(peer.size());
+  event event(events_, handle_, EVFILT_WRITE, timeout, token);
+  while (::sendto(handle_, message.data(), message.size(), 0, addr, length) < 0) {
+    if (errno != EAGAIN) {
+      co_return { errno, error_category() };
+    }
+    if (co_await event < 0) {
+      co_return { static_cast<int>(errc::cancelled), error_category() };
+    }
+  }
+  co_return {};
+}
+
+async<std::error_code> socket::send_segments(
+  const endpoint& peer, std::string_view message, std::size_t segment, std::chrono::milliseconds timeout,
+  cancellation_token token) noexcept {
+  if (segment == 0) {
+    co_return { static_cast<int>(std::errc::invalid_argument), error_category() };
+  }
+
+  // There is no segmentation offload, so the datagrams are sent one at a time.
+  do {
+    if (const auto ec = co_await send_to(peer, message.substr(0, segment), timeout, token)) {
+      co_return ec;
+    }
+    message.remove_prefix(std::min(message.size(), segment));
+  } while (!message.empty());
+  co_return {};
+}
+
+async<std::error_code> socket::send_to(
+  const std::vector<datagram>& datagrams, std::chrono::milliseconds timeout, cancellation_token token) noexcept {
+  // There is no portable batched send, so the datagrams are sent one at a time.
+  for (const auto& [peer, data] : datagrams) {
+    if (const auto ec = co_await send_to(peer, data, timeout, token)) {
+      co_return ec;
+    }
+  }
+  co_return {};
+}
+
+async<std::error_code> socket::send_zerocopy(
+  std::string_view message, std::chrono::milliseconds timeout, cancellation_token token) noexcept {
+  // Zero-copy sends are not supported.
+  co_return co_await send(message, timeout, token);
+}
+
+async<std::error_code> socket::send_file(
+  int file, std::uint64_t offset, std::uint64_t size, std::chrono::milliseconds timeout,
+  cancellation_token token) noexcept {
+  co_return { static_cast<int>(std::errc::operation_not_supported), error_category() };
+}
+
+async<std::error_code> socket::splice(
+  socket& other, std::uint64_t& count, std::chrono::milliseconds timeout, cancellation_token token) noexcept {
+  co_return { static_cast<int>(std::errc::operation_not_supported), error_category() };
+}
+
 // clang-format on
 
 std::error_code socket::close() noexcept {
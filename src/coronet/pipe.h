@@ -0,0 +1,53 @@
+#pragma once
+#include <coronet/error.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <utility>
+
+namespace coronet {
+
+// Pipe that moves data between file descriptors with splice without copying it through user space.
+class pipe final {
+public:
+  pipe() noexcept = default;
+
+  pipe(pipe&& other) noexcept :
+    reader_(std::exchange(other.reader_, -1)), writer_(std::exchange(other.writer_, -1)) {
+  }
+
+  pipe& operator=(pipe&& other) = delete;
+
+  ~pipe() {
+    if (reader_ != -1) {
+      ::close(reader_);
+    }
+    if (writer_ != -1) {
+      ::close(writer_);
+    }
+  }
+
+  // Creates the pipe.
+  std::error_code create() noexcept {
+    int handles[2] = {};
+    if (::pipe2(handles, O_CLOEXEC) < 0) {
+      return { errno, error_category() };
+    }
+    reader_ = handles[0];
+    writer_ = handles[1];
+    return {};
+  }
+
+  int reader() const noexcept {
+    return reader_;
+  }
+
+  int writer() const noexcept {
+    return writer_;
+  }
+
+private:
+  int reader_ = -1;
+  int writer_ = -1;
+};
+
+}  // namespace coronet
@@ -0,0 +1,49 @@
+#pragma once
+#include <coronet/work.h>
+#include <atomic>
+
+namespace coronet {
+
+// Lock-free multiple producer single consumer queue of work items.
+class work_queue final {
+public:
+  work_queue() noexcept = default;
+
+  work_queue(work_queue&& other) = delete;
+  work_queue& operator=(work_queue&& other) = delete;
+
+  ~work_queue() = default;
+
+  // Adds the work item to the queue. Can be called from any thread.
+  // Returns true if the queue was empty and the consumer has to be woken up.
+  bool push(work& work) noexcept {
+    auto head = head_.load(std::memory_order_relaxed);
+    do {
+      work.next_ = head;
+    } while (!head_.compare_exchange_weak(head, &work, std::memory_order_release, std::memory_order_relaxed));
+    return !head;
+  }
+
+  // Removes all work items from the queue and calls them in the order in which they were added.
+  // Work items that are added while the queue is processed are called by the next run.
+  void run() noexcept {
+    auto head = head_.exchange(nullptr, std::memory_order_acquire);
+    work* list = nullptr;
+    while (head) {
+      const auto next = head->next_;
+      head->next_ = list;
+      list = head;
+      head = next;
+    }
+    while (list) {
+      const auto next = list->next_;
+      (*list)();
+      list = next;
+    }
+  }
+
+private:
+  std::atomic<work*> head_ = nullptr;
+};
+
+}  // namespace coronet
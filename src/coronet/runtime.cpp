@@ -0,0 +1,64 @@
+#include <coronet/runtime.h>
+#include <coronet/thread.h>
+#include <thread>
+
+namespace coronet {
+
+std::error_code runtime::create(std::size_t size) noexcept {
+  auto processors = get_processors();
+  if (!size) {
+    size = processors.size();
+  }
+
+  // Create events queues.
+  std::vector<events> queues(size);
+  for (auto& queue : queues) {
+    if (const auto ec = queue.create()) {
+      return ec;
+    }
+  }
+
+  // Replace current events queues.
+  events_ = std::move(queues);
+  processors_ = std::move(processors);
+  return {};
+}
+
+std::error_code runtime::run(const policy& policy) {
+  if (events_.empty()) {
+    return { static_cast<int>(std::errc::bad_file_descriptor), error_category() };
+  }
+
+  // Run events queues and stop all of them as soon as one returns.
+  std::vector<std::error_code> errors(events_.size());
+  std::vector<std::thread> threads;
+  threads.reserve(events_.size() - 1);
+  for (std::size_t i = 1; i < events_.size(); i++) {
+    const auto processor = this->processor(i);
+    threads.emplace_back([this, &errors, &policy, i, processor]() {
+      errors[i] = events_[i].run(processor, policy);
+      stop();
+    });
+  }
+  errors[0] = events_[0].run(processor(0), policy);
+  stop();
+
+  // Wait for all events queues.
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (const auto& ec : errors) {
+    if (ec) {
+      return ec;
+    }
+  }
+  return {};
+}
+
+void runtime::stop() noexcept {
+  for (auto& events : events_) {
+    events.stop();
+  }
+}
+
+}  // namespace coronet
@@ -0,0 +1,77 @@
+#pragma once
+#include <coronet/error.h>
+#include <thread>
+#include <vector>
+
+#ifdef WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#elif defined(__FreeBSD__)
+#include <sys/param.h>
+#include <sys/cpuset.h>
+#endif
+
+namespace coronet {
+
+// Returns the processors that the calling thread is allowed to run on.
+inline std::vector<int> get_processors() {
+  std::vector<int> processors;
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (::sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (int i = 0; i < CPU_SETSIZE; i++) {
+      if (CPU_ISSET(static_cast<std::size_t>(i), &set)) {
+        processors.push_back(i);
+      }
+    }
+  }
+#endif
+  if (processors.empty()) {
+    const auto size = static_cast<int>(std::thread::hardware_concurrency());
+    for (int i = 0; i < size; i++) {
+      processors.push_back(i);
+    }
+  }
+  if (processors.empty()) {
+    processors.push_back(0);
+  }
+  return processors;
+}
+
+// Pins the calling thread to the given processor.
+inline std::error_code set_affinity(int processor) noexcept {
+#ifdef WIN32
+  if (processor >= static_cast<int>(sizeof(DWORD_PTR) * 8)) {
+    return { static_cast<int>(std::errc::invalid_argument), error_category() };
+  }
+  if (!SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << processor)) {
+    return { static_cast<int>(GetLastError()), error_category() };
+  }
+#elif defined(__linux__)
+  if (processor >= CPU_SETSIZE) {
+    return { static_cast<int>(std::errc::invalid_argument), error_category() };
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(static_cast<std::size_t>(processor), &set);
+  if (const auto rv = ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set)) {
+    return { rv, error_category() };
+  }
+#elif defined(__FreeBSD__)
+  if (processor >= CPU_SETSIZE) {
+    return { static_cast<int>(std::errc::invalid_argument), error_category() };
+  }
+  cpuset_t set;
+  CPU_ZERO(&set);
+  CPU_SET(processor, &set);
+  if (::cpuset_setaffinity(CPU_LEVEL_WHICH, CPU_WHICH_TID, -1, sizeof(set), &set) < 0) {
+    return { errno, error_category() };
+  }
+#endif
+  return {};
+}
+
+}  // namespace coronet
@@ -0,0 +1,58 @@
+#pragma once
+#include <coronet/socket.h>
+#include <netinet/udp.h>
+#include <sys/socket.h>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace coronet {
+
+// Maximum number of datagrams that the kernel sends for a single message with UDP segmentation offload.
+constexpr std::size_t max_segments = 64;
+
+// Maximum size of a message with UDP segmentation offload.
+constexpr std::size_t max_segments_size = 65507;
+
+// Control message buffer for the size of segmented or coalesced datagrams.
+struct segment_control {
+  alignas(cmsghdr) unsigned char data[CMSG_SPACE(sizeof(int))];
+};
+
+// Makes the kernel split the message into datagrams of the given size.
+inline void set_segment_size(msghdr& header, segment_control& control, std::uint16_t size) noexcept {
+  header.msg_control = control.data;
+  header.msg_controllen = sizeof(control.data);
+  const auto cmsg = CMSG_FIRSTHDR(&header);
+  cmsg->cmsg_level = SOL_UDP;
+  cmsg->cmsg_type = UDP_SEGMENT;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(size));
+  std::memcpy(CMSG_DATA(cmsg), &size, sizeof(size));
+}
+
+// Returns the size of the datagrams that the kernel coalesced into the received message or 0.
+inline std::size_t get_segment_size(msghdr& header) noexcept {
+  for (auto cmsg = CMSG_FIRSTHDR(&header); cmsg; cmsg = CMSG_NXTHDR(&header, cmsg)) {
+    if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+      int size = 0;
+      std::memcpy(&size, CMSG_DATA(cmsg), sizeof(size));
+      return size > 0 ? static_cast<std::size_t>(size) : 0;
+    }
+  }
+  return 0;
+}
+
+// Appends the datagrams of the given size that data consists of to the batch. The last datagram can be smaller.
+inline void split(std::vector<datagram>& batch, const endpoint& peer, std::string_view data, std::size_t size) {
+  if (size == 0 || size >= data.size()) {
+    batch.push_back({ peer, data });
+    return;
+  }
+  for (std::size_t offset = 0; offset < data.size(); offset += size) {
+    batch.push_back({ peer, data.substr(offset, size) });
+  }
+}
+
+}  // namespace coronet
@@ -0,0 +1,497 @@
+#pragma once
+#include <coronet/error.h>
+#include <coronet/events.h>
+#include <coronet/queue.h>
+#include <coronet/wheel.h>
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <experimental/coroutine>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <utility>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+namespace coronet {
+
+// Base class for io_uring submissions that are completed by events::run.
+class operation {
+public:
+  virtual void operator()(int result, std::uint32_t flags) noexcept = 0;
+
+protected:
+  ~operation() = default;
+};
+
+class event;
+
+class events::state final {
+public:
+  // Completion target of the submissions of an event.
+  // Outlives an event that is destroyed with submissions in flight and swallows their completions.
+  class slot final : public operation {
+  public:
+    explicit slot(state& state) noexcept : state_(state) {
+    }
+
+    void operator()(int result, std::uint32_t flags) noexcept override {
+      if (!(flags & IORING_CQE_F_MORE)) {
+        pending_--;
+      }
+      if (event_) {
+        (*event_)(result, flags);
+      } else if (!pending_) {
+        state_.release(*this);
+      }
+    }
+
+    operation* event_ = nullptr;
+    unsigned pending_ = 0;
+    slot* next_ = nullptr;
+    slot* all_ = nullptr;
+
+  private:
+    state& state_;
+  };
+
+  state() noexcept = default;
+
+  state(state&& other) = delete;
+  state& operator=(state&& other) = delete;
+
+  ~state() {
+    while (slots_) {
+      delete std::exchange(slots_, slots_->all_);
+    }
+    if (wakeup_ != -1) {
+      ::close(wakeup_);
+    }
+    if (sqes_ != MAP_FAILED) {
+      ::munmap(sqes_, sqes_size_);
+    }
+    if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) {
+      ::munmap(cq_ring_, cq_ring_size_);
+    }
+    if (sq_ring_ != MAP_FAILED) {
+      ::munmap(sq_ring_, sq_ring_size_);
+    }
+  }
+
+  // Creates io_uring instance with the given number of submission queue entries.
+  std::error_code create(unsigned entries, int& handle) noexcept {
+    struct io_uring_params params = {};
+    params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN;
+    params.cq_entries = entries * 4;
+    handle = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+    if (handle < 0 && errno == EINVAL) {
+      // Kernels before 5.19 do not support all flags.
+      params = {};
+      params.flags = IORING_SETUP_CQSIZE;
+      params.cq_entries = entries * 4;
+      handle = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+    }
+    if (handle < 0) {
+      return { errno, error_category() };
+    }
+
+    // Map submission and completion queue rings.
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+      sq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+      cq_ring_size_ = sq_ring_size_;
+    }
+    sq_ring_ = map(handle, sq_ring_size_, IORING_OFF_SQ_RING);
+    if (sq_ring_ == MAP_FAILED) {
+      return { errno, error_category() };
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+      cq_ring_ = sq_ring_;
+    } else {
+      cq_ring_ = map(handle, cq_ring_size_, IORING_OFF_CQ_RING);
+      if (cq_ring_ == MAP_FAILED) {
+        return { errno, error_category() };
+      }
+    }
+    sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+    sqes_ = map(handle, sqes_size_, IORING_OFF_SQES);
+    if (sqes_ == MAP_FAILED) {
+      return { errno, error_category() };
+    }
+
+    const auto sq = static_cast<char*>(sq_ring_);
+    sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_entries_ = params.sq_entries;
+
+    // Submission queue entries are always submitted in order.
+    const auto array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    for (unsigned i = 0; i < params.sq_entries; i++) {
+      array[i] = i;
+    }
+
+    const auto cq = static_cast<char*>(cq_ring_);
+    cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+    features_ = params.features;
+    handle_ = handle;
+
+    // Create the eventfd that wakes up events::run from other threads.
+    wakeup_ = ::eventfd(0, EFD_CLOEXEC);
+    if (wakeup_ < 0) {
+      return { errno, error_category() };
+    }
+    notify();
+    return {};
+  }
+
+  // Requests events::run to return. Thread-safe and async-signal-safe.
+  void stop() noexcept {
+    stopped_.store(true, std::memory_order_release);
+    signal();
+  }
+
+  // Queues the work item and wakes up events::run if the queue was empty. Thread-safe and async-signal-safe.
+  void post(work& work) noexcept {
+    if (queue_.push(work)) {
+      signal();
+    }
+  }
+
+  // Handles a wakeup notification and calls posted work items. Returns true if events::run should return.
+  bool wakeup() noexcept {
+    if (!notification_.completed_) {
+      return false;
+    }
+    notify();
+    queue_.run();
+    return stopped_.exchange(false, std::memory_order_acq_rel);
+  }
+
+  // Returns a cleared submission queue entry that completes the given operation.
+  // Entries are submitted in batches by events::run or when the submission queue is full.
+  struct io_uring_sqe* submission(operation* op) noexcept {
+    auto tail = *sq_tail_;
+    if (tail - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) == sq_entries_) {
+      enter(0);
+    }
+    const auto sqe = static_cast<struct io_uring_sqe*>(sqes_) + (tail & sq_mask_);
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->user_data = reinterpret_cast<std::uintptr_t>(op);
+    __atomic_store_n(sq_tail_, ++tail, __ATOMIC_RELEASE);
+    pending_++;
+    return sqe;
+  }
+
+  // Returns a cleared submission queue entry that completes the event through its slot.
+  struct io_uring_sqe* submission(event& event) noexcept;
+
+  // Returns an unused slot for the given event.
+  slot* acquire(operation& event) noexcept {
+    auto entry = free_;
+    if (entry) {
+      free_ = entry->next_;
+    } else {
+      entry = new slot(*this);
+      entry->all_ = std::exchange(slots_, entry);
+    }
+    entry->event_ = &event;
+    entry->next_ = nullptr;
+    return entry;
+  }
+
+  // Releases the slot of a destroyed event. Submissions that are still in flight are cancelled
+  // and the slot is reused after their last completion.
+  void release(slot& slot) noexcept {
+    slot.event_ = nullptr;
+    if (slot.pending_) {
+      const auto sqe = submission(nullptr);
+      sqe->opcode = IORING_OP_ASYNC_CANCEL;
+      sqe->addr = reinterpret_cast<std::uintptr_t>(static_cast<operation*>(&slot));
+      return;
+    }
+    slot.next_ = std::exchange(free_, &slot);
+  }
+
+  // Submits queued entries and waits for the given number of completions or the given number of milliseconds.
+  // Returns the number of submitted entries or a negative error code.
+  int enter(unsigned wait, std::uint64_t timeout = wheel::infinite) noexcept {
+    auto flags = wait ? IORING_ENTER_GETEVENTS : 0U;
+    struct io_uring_getevents_arg arg = {};
+    auto arg_data = static_cast<void*>(nullptr);
+    auto arg_size = std::size_t(0);
+    if (wait && timeout != wheel::infinite) {
+      timespec_.tv_sec = static_cast<long long>(timeout / 1000);
+      timespec_.tv_nsec = static_cast<long long>(timeout % 1000 * 1000000);
+      if (features_ & IORING_FEAT_EXT_ARG) {
+        arg.ts = reinterpret_cast<std::uintptr_t>(&timespec_);
+        arg_data = &arg;
+        arg_size = sizeof(arg);
+        flags |= IORING_ENTER_EXT_ARG;
+      } else {
+        // Kernels before 5.11 can only time out with a timeout submission.
+        expire(timeout);
+      }
+    }
+    const auto rv =
+      static_cast<int>(::syscall(__NR_io_uring_enter, handle_, pending_, wait, flags, arg_data, arg_size));
+    if (rv < 0) {
+      return -errno;
+    }
+    pending_ -= std::min(pending_, static_cast<unsigned>(rv));
+    return rv;
+  }
+
+  // Returns the timing wheel of the events queue.
+  wheel& timers() noexcept {
+    return timers_;
+  }
+
+  // Enables busy polling of network device queues for the given time (Linux 6.9).
+  // Kernels that do not support busy polling are ignored.
+  std::error_code napi(std::chrono::microseconds timeout) noexcept {
+    struct {
+      std::uint32_t busy_poll_to;
+      std::uint8_t prefer_busy_poll;
+      std::uint8_t pad[3];
+      std::uint64_t resv;
+    } params = {};
+    params.busy_poll_to = static_cast<std::uint32_t>(timeout.count());
+    params.prefer_busy_poll = 1;
+    constexpr unsigned register_napi = 27;
+    if (::syscall(__NR_io_uring_register, handle_, register_napi, &params, 1) < 0 && errno != EINVAL) {
+      return { errno, error_category() };
+    }
+    return {};
+  }
+
+  // Handles all available completions. Returns the number of handled completions.
+  std::size_t complete() noexcept {
+    std::size_t count = 0;
+    auto head = *cq_head_;
+    while (head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+      const auto cqe = cqes_[head & cq_mask_];
+      __atomic_store_n(cq_head_, ++head, __ATOMIC_RELEASE);
+      if (const auto op = reinterpret_cast<operation*>(static_cast<std::uintptr_t>(cqe.user_data))) {
+        (*op)(cqe.res, cqe.flags);
+      }
+      count++;
+    }
+    return count;
+  }
+
+private:
+  // Read operation on the wakeup eventfd.
+  class notification final : public operation {
+  public:
+    void operator()(int result, std::uint32_t flags) noexcept override {
+      completed_ = true;
+    }
+
+    std::uint64_t value_ = 0;
+    bool completed_ = false;
+  };
+
+  // Timeout submission that wakes up io_uring_enter on kernels without IORING_FEAT_EXT_ARG.
+  class expiry final : public operation {
+  public:
+    void operator()(int result, std::uint32_t flags) noexcept override {
+      pending_--;
+    }
+
+    std::chrono::steady_clock::time_point deadline_;
+    unsigned pending_ = 0;
+  };
+
+  // Keeps one timeout submission in flight that expires after the given number of milliseconds or earlier.
+  // A timeout that expires later is removed and completes with -ECANCELED.
+  void expire(std::uint64_t timeout) noexcept {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+    if (expiry_.pending_) {
+      if (expiry_.deadline_ <= deadline) {
+        return;
+      }
+      const auto sqe = submission(nullptr);
+      sqe->opcode = IORING_OP_TIMEOUT_REMOVE;
+      sqe->addr = reinterpret_cast<std::uintptr_t>(static_cast<operation*>(&expiry_));
+    }
+    const auto sqe = submission(&expiry_);
+    sqe->opcode = IORING_OP_TIMEOUT;
+    sqe->addr = reinterpret_cast<std::uintptr_t>(&timespec_);
+    sqe->len = 1;
+    expiry_.deadline_ = deadline;
+    expiry_.pending_++;
+  }
+
+  // Writes to the wakeup eventfd.
+  void signal() noexcept {
+    const std::uint64_t value = 1;
+    [[maybe_unused]] const auto rv = ::write(wakeup_, &value, sizeof(value));
+  }
+
+  // Submits a read of the wakeup eventfd.
+  void notify() noexcept {
+    notification_.completed_ = false;
+    const auto sqe = submission(&notification_);
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = wakeup_;
+    sqe->addr = reinterpret_cast<std::uintptr_t>(&notification_.value_);
+    sqe->len = sizeof(notification_.value_);
+  }
+
+  static void* map(int handle, std::size_t size, unsigned long long offset) noexcept {
+    return ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, handle, static_cast<off_t>(offset));
+  }
+
+  int handle_ = -1;
+  unsigned pending_ = 0;
+  unsigned features_ = 0;
+  struct __kernel_timespec timespec_ = {};
+  expiry expiry_;
+  wheel timers_;
+
+  int wakeup_ = -1;
+  std::atomic<bool> stopped_ = false;
+  notification notification_;
+  work_queue queue_;
+  slot* free_ = nullptr;
+  slot* slots_ = nullptr;
+
+  void* sq_ring_ = MAP_FAILED;
+  std::size_t sq_ring_size_ = 0;
+  unsigned* sq_head_ = nullptr;
+  unsigned* sq_tail_ = nullptr;
+  unsigned sq_mask_ = 0;
+  unsigned sq_entries_ = 0;
+
+  void* sqes_ = MAP_FAILED;
+  std::size_t sqes_size_ = 0;
+
+  void* cq_ring_ = MAP_FAILED;
+  std::size_t cq_ring_size_ = 0;
+  unsigned* cq_head_ = nullptr;
+  unsigned* cq_tail_ = nullptr;
+  unsigned cq_mask_ = 0;
+  struct io_uring_cqe* cqes_ = nullptr;
+};
+
+class event final : public operation {
+public:
+  using handle_type = std::experimental::coroutine_handle<>;
+
+  explicit event(
+    events::state& state, std::chrono::milliseconds timeout = {}, cancellation_token token = {}) noexcept :
+    state_(state), timeout_(timeout), token_(token), deadline_(*this) {
+  }
+
+  event(event&& other) = delete;
+  event(const event& other) = delete;
+
+  event& operator=(event&& other) = delete;
+  event& operator=(const event& other) = delete;
+
+  // A suspended frame can be destroyed while a submission is in flight, so its completion goes to the slot.
+  ~event() {
+    disarm();
+    if (slot_) {
+      state_.release(*slot_);
+    }
+  }
+
+  constexpr bool await_ready() noexcept {
+    return ready_;
+  }
+
+  void await_suspend(handle_type handle) noexcept {
+    handle_ = handle;
+    if (!token_.attach(deadline_)) {
+      deadline_();
+      return;
+    }
+    if (timeout_.count() > 0) {
+      state_.timers().start(deadline_, timeout_);
+    }
+  }
+
+  constexpr auto await_resume() noexcept {
+    return result_;
+  }
+
+  void operator()(int result, std::uint32_t flags) noexcept override {
+    disarm();
+    result_ = result;
+    flags_ = flags;
+    ready_ = true;
+    if (auto handle = std::exchange(handle_, nullptr)) {
+      handle.resume();
+    }
+  }
+
+  // Returns the flags of the last completion.
+  constexpr std::uint32_t flags() const noexcept {
+    return flags_;
+  }
+
+  void reset() noexcept {
+    ready_ = false;
+    result_ = 0;
+    flags_ = 0;
+  }
+
+private:
+  friend class events::state;
+
+  // Cancels the submission when the timeout expires or the token is cancelled.
+  // The submission completes with -ECANCELED unless it already completed.
+  class deadline final : public timer, public cancellation_callback {
+  public:
+    explicit deadline(event& event) noexcept : event_(event) {
+    }
+
+    void operator()() noexcept override {
+      event_.disarm();
+      if (event_.slot_ && event_.slot_->pending_) {
+        const auto sqe = event_.state_.submission(nullptr);
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->addr = reinterpret_cast<std::uintptr_t>(static_cast<operation*>(event_.slot_));
+      }
+    }
+
+  private:
+    event& event_;
+  };
+
+  // Cancels the timeout and unregisters the cancellation callback.
+  void disarm() noexcept {
+    state_.timers().cancel(deadline_);
+    deadline_.reset();
+  }
+
+  events::state& state_;
+  bool ready_ = false;
+  int result_ = 0;
+  std::uint32_t flags_ = 0;
+  handle_type handle_ = nullptr;
+  std::chrono::milliseconds timeout_;
+  cancellation_token token_;
+  deadline deadline_;
+  events::state::slot* slot_ = nullptr;
+};
+
+inline struct io_uring_sqe* events::state::submission(event& event) noexcept {
+  if (!event.slot_) {
+    event.slot_ = acquire(event);
+  }
+  event.slot_->pending_++;
+  return submission(event.slot_);
+}
+
+}  // namespace coronet
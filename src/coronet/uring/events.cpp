@@ -0,0 +1,117 @@
+#include <coronet/events.h>
+#include <coronet/uring/event.h>
+#include <coronet/thread.h>
+#include <unistd.h>
+#include <chrono>
+#include <cerrno>
+
+namespace coronet {
+
+events::~events() {
+  delete state_;
+}
+
+std::error_code events::create() noexcept {
+  // Create a new io_uring handle.
+  auto handle = invalid_handle_value;
+  const auto ring = new state();
+  const auto ec = ring->create(1024, handle);
+  events events(handle);
+  events.state_ = ring;
+  if (ec) {
+    return ec;
+  }
+
+  // Replace current io_uring handle.
+  if (const auto ec = close()) {
+    return ec;
+  }
+  *this = std::move(events);
+  return {};
+}
+
+std::error_code events::run(int processor, const policy& policy) {
+  if (!valid()) {
+    return { static_cast<int>(std::errc::bad_file_descriptor), error_category() };
+  }
+
+  // Pin the current thread to the given processor.
+  if (processor >= 0) {
+    if (const auto ec = set_affinity(processor)) {
+      return ec;
+    }
+  }
+
+  // Enable busy polling of network device queues.
+  auto& state = *state_;
+  if (policy.busy_poll.count() > 0) {
+    if (const auto ec = state.napi(policy.busy_poll)) {
+      return ec;
+    }
+  }
+
+  // Make the events queue available to coroutines that run on this thread.
+  const auto previous = std::exchange(current_, this);
+
+  // Submit queued entries and handle completed events.
+  // The completion queue is drained completely, so the batch size does not apply.
+  std::error_code ec;
+  auto& timers = state.timers();
+  auto spin = std::chrono::steady_clock::time_point();
+  while (true) {
+    if (state.complete() && policy.spin.count() > 0) {
+      spin = std::chrono::steady_clock::now() + policy.spin;
+    }
+    timers.advance();
+    if (state.wakeup()) {
+      break;
+    }
+    const auto spinning = policy.spin.count() > 0 && std::chrono::steady_clock::now() < spin;
+    if (const auto rv = state.enter(spinning ? 0 : 1, timers.timeout()); rv < 0) {
+      // Signal handlers stop the events queue with events::stop.
+      if (rv == -EBUSY || rv == -ETIME || rv == -EINTR) {
+        continue;
+      }
+      ec = { -rv, error_category() };
+      break;
+    }
+  }
+  current_ = previous;
+  return ec;
+}
+
+void events::stop() noexcept {
+  if (state_) {
+    state_->stop();
+  }
+}
+
+void events::start(timer& timer, std::chrono::milliseconds duration) noexcept {
+  if (state_) {
+    state_->timers().start(timer, duration);
+  }
+}
+
+void events::cancel(timer& timer) noexcept {
+  if (state_) {
+    state_->timers().cancel(timer);
+  }
+}
+
+void events::post(work& work) noexcept {
+  if (state_) {
+    state_->post(work);
+  }
+}
+
+std::error_code events::close() noexcept {
+  if (valid()) {
+    if (::close(handle_) < 0) {
+      return { errno, error_category() };
+    }
+    handle_ = invalid_handle_value;
+  }
+  return {};
+}
+
+}  // namespace coronet
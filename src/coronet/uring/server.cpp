@@ -0,0 +1,286 @@
+#include <coronet/server.h>
+#include <coronet/address.h>
+#include <coronet/uring/event.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <linux/filter.h>
+#include <unistd.h>
+#include <memory>
+#include <vector>
+
+namespace coronet {
+namespace {
+
+// Multishot accept operation that queues accepted connections until they are requested.
+// The operation owns itself while a submission is in flight, because multishot completions
+// can arrive after the accept generator was destroyed.
+class acceptor final : public operation {
+public:
+  using handle_type = std::experimental::coroutine_handle<>;
+
+  acceptor(events::state& state, int server, std::chrono::milliseconds timeout, cancellation_token token) noexcept :
+    state_(state), deadline_(*this), timeout_(timeout), token_(token), server_(server) {
+  }
+
+  acceptor(acceptor&& other) = delete;
+  acceptor& operator=(acceptor&& other) = delete;
+
+  bool await_ready() noexcept {
+    return next_ < sockets_.size() || error_ || token_.cancelled();
+  }
+
+  void await_suspend(handle_type handle) noexcept {
+    handle_ = handle;
+    token_.attach(deadline_);
+    if (timeout_.count() > 0 && !deadline_.armed()) {
+      state_.timers().start(deadline_, timeout_);
+    }
+    if (!armed_) {
+      armed_ = true;
+      const auto sqe = state_.submission(this);
+      sqe->opcode = IORING_OP_ACCEPT;
+      sqe->fd = server_;
+      sqe->accept_flags = SOCK_NONBLOCK;
+      if (multishot_) {
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+      }
+    }
+  }
+
+  // Returns the next accepted connection or a negative error code.
+  int await_resume() noexcept {
+    disarm();
+    if (token_.cancelled()) {
+      return -ECANCELED;
+    }
+    if (next_ < sockets_.size()) {
+      const auto socket = sockets_[next_++];
+      if (next_ == sockets_.size()) {
+        sockets_.clear();
+        next_ = 0;
+      }
+      return socket;
+    }
+    return -std::exchange(error_, 0);
+  }
+
+  void operator()(int result, std::uint32_t flags) noexcept override {
+    if (!(flags & IORING_CQE_F_MORE)) {
+      armed_ = false;
+    }
+    if (orphaned_) {
+      if (result >= 0) {
+        ::close(result);
+      }
+      if (!armed_) {
+        delete this;
+      }
+      return;
+    }
+    if (result >= 0) {
+      sockets_.push_back(result);
+    } else if (result == -EINVAL && multishot_) {
+      // Kernels before 5.19 do not support multishot accept.
+      multishot_ = false;
+    } else if (result != -EAGAIN && result != -EINTR && result != -ECANCELED) {
+      error_ = -result;
+    }
+    if (const auto handle = std::exchange(handle_, nullptr)) {
+      if (await_ready()) {
+        handle.resume();
+      } else {
+        await_suspend(handle);
+      }
+    }
+  }
+
+  // Closes queued connections and cancels the pending submission.
+  void release() noexcept {
+    disarm();
+    for (auto i = next_; i < sockets_.size(); i++) {
+      ::close(sockets_[i]);
+    }
+    if (!armed_) {
+      delete this;
+      return;
+    }
+    orphaned_ = true;
+    const auto sqe = state_.submission(nullptr);
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->addr = reinterpret_cast<std::uintptr_t>(static_cast<operation*>(this));
+  }
+
+private:
+  // Resumes the accept generator with -ECANCELED when no connection was accepted in time or the token is cancelled.
+  class deadline final : public timer, public cancellation_callback {
+  public:
+    explicit deadline(acceptor& acceptor) noexcept : acceptor_(acceptor) {
+    }
+
+    void operator()() noexcept override {
+      acceptor_.disarm();
+      acceptor_.error_ = ECANCELED;
+      if (const auto handle = std::exchange(acceptor_.handle_, nullptr)) {
+        handle.resume();
+      }
+    }
+
+  private:
+    acceptor& acceptor_;
+  };
+
+  // Cancels the timeout and unregisters the cancellation callback.
+  void disarm() noexcept {
+    state_.timers().cancel(deadline_);
+    deadline_.reset();
+  }
+
+  events::state& state_;
+  deadline deadline_;
+  std::chrono::milliseconds timeout_;
+  cancellation_token token_;
+  handle_type handle_ = nullptr;
+  std::vector<int> sockets_;
+  std::size_t next_ = 0;
+  int server_ = -1;
+  int error_ = 0;
+  bool armed_ = false;
+  bool multishot_ = true;
+  bool orphaned_ = false;
+};
+
+}  // namespace
+
+std::error_code server::create(const std::string& host, const std::string& port, type type, bool reuseport) noexcept {
+  if (!events_.get()) {
+    return { static_cast<int>(std::errc::bad_file_descriptor), error_category() };
+  }
+
+  // Convert host and port to socket address and options.
+  address address;
+  if (const auto ec = address.create(host, port, type, AI_PASSIVE)) {
+    return ec;
+  }
+
+  // Create listening socket.
+  server server(events_);
+  if (const auto ec = static_cast<socket&>(server).create(address.family(), address.type(), address.protocol())) {
+    return ec;
+  }
+
+  // Set SO_REUSEADDR socket option.
+  auto reuseaddr = 1;
+  if (::setsockopt(server.value(), SOL_SOCKET, SO_REUSEADDR, &reuseaddr, sizeof(reuseaddr)) < 0) {
+    return { errno, error_category() };
+  }
+
+  // Set SO_REUSEPORT socket option.
+  if (reuseport) {
+    auto value = 1;
+    if (::setsockopt(server.value(), SOL_SOCKET, SO_REUSEPORT, &value, sizeof(value)) < 0) {
+      return { errno, error_category() };
+    }
+  }
+
+  // Bind listening socket to the given address.
+  if (::bind(server.value(), address.addr(), address.addrlen()) < 0) {
+    return { errno, error_category() };
+  }
+
+  // Replace current socket.
+  if (const auto ec = close()) {
+    return ec;
+  }
+  *this = std::move(server);
+  protocol_ = address.protocol();
+  family_ = address.family();
+  type_ = address.type();
+  return {};
+}
+
+std::error_code server::create(const server& other) noexcept {
+  if (!events_.get()) {
+    return { static_cast<int>(std::errc::bad_file_descriptor), error_category() };
+  }
+
+  // Duplicate listening socket.
+  server server(events_, ::dup(other.value()));
+  if (!server) {
+    return { errno, error_category() };
+  }
+
+  // Replace current socket.
+  if (const auto ec = close()) {
+    return ec;
+  }
+  *this = std::move(server);
+  protocol_ = other.protocol_;
+  family_ = other.family_;
+  type_ = other.type_;
+  return {};
+}
+
+std::error_code server::steer(const std::vector<int>& processors) noexcept {
+  if (processors.empty() || processors.size() > BPF_MAXINSNS / 2 - 1) {
+    return { static_cast<int>(std::errc::invalid_argument), error_category() };
+  }
+
+  // Return the index of the first server that runs on the current processor.
+  // Indices that are out of range make the kernel fall back to hash based selection.
+  std::vector<struct sock_filter> code;
+  code.reserve(processors.size() * 2 + 2);
+  code.push_back(BPF_STMT(BPF_LD | BPF_W | BPF_ABS, static_cast<__u32>(SKF_AD_OFF + SKF_AD_CPU)));
+  for (std::size_t i = 0; i < processors.size(); i++) {
+    code.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, static_cast<__u32>(processors[i]), 0, 1));
+    code.push_back(BPF_STMT(BPF_RET | BPF_K, static_cast<__u32>(i)));
+  }
+  code.push_back(BPF_STMT(BPF_RET | BPF_K, static_cast<__u32>(processors.size())));
+
+  // Attach program to the reuseport group of the listening socket.
+  struct sock_fprog program = {};
+  program.len = static_cast<unsigned short>(code.size());
+  program.filter = code.data();
+  if (::setsockopt(handle_, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &program, sizeof(program)) < 0) {
+    return { errno, error_category() };
+  }
+  return {};
+}
+
+local_async_generator<socket> server::accept(
+  std::size_t backlog, std::chrono::milliseconds timeout, cancellation_token token) noexcept {
+  ec_.clear();
+  const auto state = events_.get().data();
+  if (!state) {
+    ec_ = { static_cast<int>(std::errc::bad_file_descriptor), error_category() };
+    co_return;
+  }
+
+  // Start listening on the socket.
+  if (::listen(handle_, backlog > 0 ? static_cast<int>(backlog) : SOMAXCONN) < 0) {
+    ec_ = { errno, error_category() };
+    co_return;
+  }
+
+  // Accept connections.
+  const auto release = [](acceptor* op) {
+    op->release();
+  };
+  const std::unique_ptr<acceptor, void (*)(acceptor*)> op(new acceptor(*state, handle_, timeout, token), release);
+  auto& connections = *op;
+  while (true) {
+    const auto rv = co_await connections;
+    if (rv == -ECANCELED) {
+      ec_ = { static_cast<int>(errc::cancelled), error_category() };
+      co_return;
+    }
+    if (rv < 0) {
+      ec_ = { -rv, error_category() };
+      co_return;
+    }
+    socket socket(events_, rv);
+    co_yield socket;
+  }
+  co_return;
+}
+
+}  // namespace coronet
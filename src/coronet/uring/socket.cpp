@@ -0,0 +1,743 @@
+#include <coronet/socket.h>
+#include <coronet/address.h>
+#include <coronet/uring/event.h>
+#include <coronet/pipe.h>
+#include <coronet/udp.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <poll.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <limits>
+
+namespace coronet {
+namespace {
+
+// Submits a poll for readiness of the socket or file that completes the event.
+// Used with non-blocking system calls that have no submission or whose submissions block kernel worker threads.
+void poll(events::state& state, event& event, int socket, std::uint32_t events) noexcept {
+  event.reset();
+  const auto sqe = state.submission(event);
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = socket;
+  sqe->poll32_events = events;
+}
+
+}  // namespace
+
+std::error_code socket::create(family family, type type, int protocol) noexcept {
+  if (!events_.get()) {
+    return { static_cast<int>(std::errc::bad_file_descriptor), error_category() };
+  }
+
+  // Create a new socket.
+  socket socket(events_, ::socket(to_int(family), to_int(type) | SOCK_NONBLOCK, protocol));
+  if (!socket) {
+    return { errno, error_category() };
+  }
+
+  // Replace current socket.
+  if (const auto ec = close()) {
+    return ec;
+  }
+  *this = std::move(socket);
+  return {};
+}
+
+std::error_code socket::set(option option, bool enable) noexcept {
+  auto level = 0;
+  auto sockopt = 0;
+  switch (option) {
+  case option::nodelay:
+    level = IPPROTO_TCP;
+    sockopt = TCP_NODELAY;
+    break;
+  case option::gro:
+    level = IPPROTO_UDP;
+    sockopt = UDP_GRO;
+    break;
+  }
+  auto value = enable ? 1 : 0;
+  if (::setsockopt(handle_, level, sockopt, &value, sizeof(value)) < 0) {
+    return { errno, error_category() };
+  }
+  return {};
+}
+
+int socket::processor() const noexcept {
+  auto processor = -1;
+  auto size = static_cast<socklen_t>(sizeof(processor));
+  if (::getsockopt(handle_, SOL_SOCKET, SO_INCOMING_CPU, &processor, &size) < 0) {
+    return -1;
+  }
+  return processor;
+}
+
+// clang-format off
+
+local_async_generator<std::string_view> socket::recv(
+  void* data, std::size_t size, std::chrono::milliseconds timeout, cancellation_token token) noexcept {
+  ec_.clear();
+  const auto state = events_.get().data();
+  if (!state) {
+    ec_ = { static_cast<int>(std::errc::bad_file_descriptor), error_category() };
+    co_return;
+  }
+  event event(*state, timeout, token);
+  const auto len = static_cast<std::uint32_t>(std::min<std::size_t>(size, std::numeric_limits<std::uint32_t>::max()));
+  while (true) {
+    event.reset();
+    const auto sqe = state->submission(event);
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = handle_;
+    sqe->addr = reinterpret_cast<std::uintptr_t>(data);
+    sqe->len = len;
+    const auto rv = co_await event;
+    if (rv < 0) {
+      if (rv == -EAGAIN || rv == -EINTR) {
+        continue;
+      }
+      if (rv == -ECANCELED) {
+        ec_ = { static_cast<int>(errc::cancelled), error_category() };
+        co_return;
+      }
+      ec_ = { -rv, error_category() };
+      co_return;
+    }
+    if (rv == 0) {
+      ec_ = { static_cast<int>(errc::eof), error_category() };
+      co_return;
+    }
+    std::string_view result(reinterpret_cast<const char*>(data), static_cast<std::size_t>(rv));
+    co_yield result;
+  }
+  co_return;
+}
+
+local_async_generator<const std::vector<std::string_view>&> socket::recv(
+  std::vector<std::string>& buffers, std::chrono::milliseconds timeout, cancellation_token token) noexcept {
+  ec_.clear();
+  const auto state = events_.get().data();
+  if (!state) {
+    ec_ = { static_cast<int>(std::errc::bad_file_descriptor), error_category() };
+    co_return;
+  }
+  if (std::all_of(buffers.begin(), buffers.end(), [](const auto& buffer) { return buffer.empty(); })) {
+    ec_ = { static_cast<int>(std::errc::invalid_argument), error_category() };
+    co_return;
+  }
+  event event(*state, timeout, token);
+  std::vector<iovec> chain(buffers.size());
+  std::vector<std::string_view> batch;
+  batch.reserve(buffers.size());
+  const auto count = static_cast<std::uint32_t>(std::min<std::size_t>(chain.size(), IOV_MAX));
+  while (true) {
+    // A single vectored read fills the buffers with all data that is available.
+    for (std::size_t i = 0; i < buffers.size(); i++) {
+      chain[i] = { buffers[i].data(), buffers[i].size() };
+    }
+    event.reset();
+    const auto sqe = state->submission(event);
+    sqe->opcode = IORING_OP_READV;
+    sqe->fd = handle_;
+    sqe->addr = reinterpret_cast<std::uintptr_t>(chain.data());
+    sqe->len = count;
+    const auto rv = co_await event;
+    if (rv < 0) {
+      if (rv == -EAGAIN || rv == -EINTR) {
+        continue;
+      }
+      if (rv == -ECANCELED) {
+        ec_ = { static_cast<int>(errc::cancelled), error_category() };
+        co_return;
+      }
+      ec_ = { -rv, error_category() };
+      co_return;
+    }
+    if (rv == 0) {
+      ec_ = { static_cast<int>(errc::eof), error_category() };
+      co_return;
+    }
+    batch.clear();
+    auto bytes = static_cast<std::size_t>(rv);
+    for (std::size_t i = 0; i < buffers.size() && bytes > 0; i++) {
+      if (const auto size = std::min(bytes, buffers[i].size())) {
+        batch.emplace_back(buffers[i].data(), size);
+        bytes -= size;
+      }
+    }
+    co_yield batch;
+  }
+  co_return;
+}
+
+local_async_generator<const datagram&> socket::recv_from(
+  void* data, std::size_t size, std::chrono::milliseconds timeout, cancellation_token token) noexcept {
+  ec_.clear();
+  const auto state = events_.get().data();
+  if (!state) {
+    ec_ = { static_cast<int>(std::errc::bad_file_descriptor), error_category() };
+    co_return;
+  }
+  event event(*state, timeout, token);
+  datagram result;
+  segment_control control;
+  struct iovec vector = { data, size };
+  struct msghdr message = {};
+  message.msg_name = result.peer.data();
+  message.msg_iov = &vector;
+  message.msg_iovlen = 1;
+  while (true) {
+    message.msg_namelen = static_cast<socklen_t>(endpoint::capacity);
+    message.msg_control = control.data;
+    message.msg_controllen = sizeof(control.data);
+    event.reset();
+    const auto sqe = state->submission(event);
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = handle_;
+    sqe->addr = reinterpret_cast<std::uintptr_t>(&message);
+    sqe->len = 1;
+    const auto rv = co_await event;
+    if (rv < 0) {
+      if (rv == -EAGAIN || rv == -EINTR) {
+        continue;
+      }
+      if (rv == -ECANCELED) {
+        ec_ = { static_cast<int>(errc::cancelled), error_category() };
+        co_return;
+      }
+      ec_ = { -rv, error_category() };
+      co_return;
+    }
+    result.peer.resize(message.msg_namelen);
+
+    // Datagrams that the kernel coalesced are yielded one by one.
+    const std::string_view received(reinterpret_cast<const char*>(data), static_cast<std::size_t>(rv));
+    const auto segment = get_segment_size(message);
+    const auto step = segment ? segment : received.size();
+    std::size_t offset = 0;
+    do {
+      result.data = received.substr(offset, step);
+      co_yield result;
+      offset += step;
+    } while (offset < received.size());
+  }
+  co_return;
+}
+
+local_async_generator<const std::vector<datagram>&> socket::recv_from(
+  std::vector<std::string>& buffers, std::chrono::milliseconds timeout, cancellation_token token) noexcept {
+  ec_.clear();
+  const auto state = events_.get().data();
+  if (!state) {
+    ec_ = { static_cast<int>(std::errc::bad_file_descriptor), error_category() };
+    co_return;
+  }
+  if (buffers.empty()) {
+    ec_ = { static_cast<int>(std::errc::invalid_argument), error_category() };
+    co_return;
+  }
+  const auto count = std::min<std::size_t>(buffers.size(), UIO_MAXIOV);
+  std::vector<endpoint> peers(count);
+  std::vector<iovec> vectors(count);
+  std::vector<segment_control> controls(count);
+  std::vector<mmsghdr> messages(count);
+  for (std::size_t i = 0; i < count; i++) {
+    vectors[i] = { buffers[i].data(), buffers[i].size() };
+    messages[i].msg_hdr.msg_name = peers[i].data();
+    messages[i].msg_hdr.msg_iov = &vectors[i];
+    messages[i].msg_hdr.msg_iovlen = 1;
+    messages[i].msg_hdr.msg_control = controls[i].data;
+  }
+  std::vector<datagram> batch;
+  batch.reserve(count);
+
+  // There is no batched receive submission, so the socket is polled and read with recvmmsg.
+  event event(*state, timeout, token);
+  while (true) {
+    for (auto& message : messages) {
+      message.msg_hdr.msg_namelen = static_cast<socklen_t>(endpoint::capacity);
+      message.msg_hdr.msg_controllen = sizeof(segment_control::data);
+    }
+    const auto rv = ::recvmmsg(handle_, messages.data(), static_cast<unsigned>(count), MSG_DONTWAIT, nullptr);
+    if (rv < 0) {
+      if (errno != EAGAIN) {
+        ec_ = { errno, error_category() };
+        co_return;
+      }
+      poll(*state, event, handle_, POLLIN);
+      if (const auto result = co_await event; result < 0) {
+        if (result == -ECANCELED) {
+          ec_ = { static_cast<int>(errc::cancelled), error_category() };
+          co_return;
+        }
+        ec_ = { -result, error_category() };
+        co_return;
+      }
+      continue;
+    }
+    batch.clear();
+    for (std::size_t i = 0; i < static_cast<std::size_t>(rv); i++) {
+      peers[i].resize(messages[i].msg_hdr.msg_namelen);
+      const std::string_view received(buffers[i].data(), messages[i].msg_len);
+      split(batch, peers[i], received, get_segment_size(messages[i].msg_hdr));
+    }
+    co_yield batch;
+  }
+  co_return;
+}
+
+async<std::error_code> socket::send(
+  std::string_view message, std::chrono::milliseconds timeout, cancellation_token token) noexcept {
+  const auto state = events_.get().data();
+  if (!state) {
+    co_return { static_cast<int>(std::errc::bad_file_descriptor), error_category() };
+  }
+  event event(*state, timeout, token);
+  auto data = message.data();
+  auto size = message.size();
+  while (size > 0) {
+    event.reset();
+    const auto sqe = state->submission(event);
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = handle_;
+    sqe->addr = reinterpret_cast<std::uintptr_t>(data);
+    sqe->len = static_cast<std::uint32_t>(std::min<std::size_t>(size, std::numeric_limits<std::uint32_t>::max()));
+    sqe->msg_flags = MSG_NOSIGNAL;
+    const auto rv = co_await event;
+    if (rv < 0) {
+      if (rv == -EAGAIN || rv == -EINTR) {
+        continue;
+      }
+      if (rv == -ECANCELED) {
+        co_return { static_cast<int>(errc::cancelled), error_category() };
+      }
+      co_return { -rv, error_category() };
+    }
+    if (rv == 0) {
+      co_return { static_cast<int>(errc::eof), error_category() };
+    }
+    const auto bytes = static_cast<std::size_t>(rv);
+    data += bytes;
+    size -= bytes > size ? size : bytes;
+  }
+  co_return {};
+}
+
+async<std::error_code> socket::send(
+  const std::vector<std::string_view>& buffers, std::chrono::milliseconds timeout, cancellation_token token) noexcept {
+  const auto state = events_.get().data();
+  if (!state) {
+    co_return { static_cast<int>(std::errc::bad_file_descriptor), error_category() };
+  }
+
+  // Short chains are stored in the coroutine frame.
+  std::array<iovec, 8> small;
+  std::vector<iovec> large;
+  if (buffers.size() > small.size()) {
+    large.resize(buffers.size());
+  }
+  auto vector = large.empty() ? small.data() : large.data();
+  std::size_t count = 0;
+  for (const auto buffer : buffers) {
+    if (!buffer.empty()) {
+      vector[count++] = { const_cast<char*>(buffer.data()), buffer.size() };
+    }
+  }
+  event event(*state, timeout, token);
+  struct msghdr message = {};
+  while (count > 0) {
+    message.msg_iov = vector;
+    message.msg_iovlen = std::min<std::size_t>(count, IOV_MAX);
+    event.reset();
+    const auto sqe = state->submission(event);
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = handle_;
+    sqe->addr = reinterpret_cast<std::uintptr_t>(&message);
+    sqe->len = 1;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    const auto rv = co_await event;
+    if (rv < 0) {
+      if (rv == -EAGAIN || rv == -EINTR) {
+        continue;
+      }
+      if (rv == -ECANCELED) {
+        co_return { static_cast<int>(errc::cancelled), error_category() };
+      }
+      co_return { -rv, error_category() };
+    }
+    if (rv == 0) {
+      co_return { static_cast<int>(errc::eof), error_category() };
+    }
+    auto bytes = static_cast<std::size_t>(rv);
+    while (count > 0 && bytes >= vector->iov_len) {
+      bytes -= vector->iov_len;
+      vector++;
+      count--;
+    }
+    if (count > 0) {
+      vector->iov_base = static_cast<char*>(vector->iov_base) + bytes;
+      vector->iov_len -= bytes;
+    }
+  }
+  co_return {};
+}
+
+async<std::error_code> socket::send_to(
+  const endpoint& peer, std::string_view message, std::chrono::milliseconds timeout,
+  cancellation_token token) noexcept {
+  const auto state = events_.get().data();
+  if (!state) {
+    co_return { static_cast<int>(std::errc::bad_file_descriptor), error_category() };
+  }
+  event event(*state, timeout, token);
+  struct iovec vector = { const_cast<char*>(message.data()), message.size() };
+  struct msghdr header = {};
+  header.msg_name = peer.size() ? const_cast<void*>(peer.data()) : nullptr;
+  header.msg_namelen = static_cast<socklen_t>(peer.size());
+  header.msg_iov = &vector;
+  header.msg_iovlen = 1;
+  while (true) {
+    event.reset();
+    const auto sqe = state->submission(event);
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = handle_;
+    sqe->addr = reinterpret_cast<std::uintptr_t>(&header);
+    sqe->len = 1;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    const auto rv = co_await event;
+    if (rv < 0) {
+      if (rv == -EAGAIN || rv == -EINTR) {
+        continue;
+      }
+      if (rv == -ECANCELED) {
+        co_return { static_cast<int>(errc::cancelled), error_category() };
+      }
+      co_return { -rv, error_category() };
+    }
+    co_return {};
+  }
+  co_return {};
+}
+
+async<std::error_code> socket::send_segments(
+  const endpoint& peer, std::string_view message, std::size_t segment, std::chrono::milliseconds timeout,
+  cancellation_token token) noexcept {
+  const auto state = events_.get().data();
+  if (!state) {
+    co_return { static_cast<int>(std::errc::bad_file_descriptor), error_category() };
+  }
+  if (segment == 0 || segment > max_segments_size) {
+    co_return { static_cast<int>(std::errc::invalid_argument), error_category() };
+  }
+  if (message.size() <= segment) {
+    co_return co_await send_to(peer, message, timeout, token);
+  }
+
+  // A single submission sends up to max_segments datagrams and max_segments_size bytes.
+  const auto chunk = segment * std::clamp<std::size_t>(max_segments_size / segment, 1, max_segments);
+  segment_control control;
+  struct iovec vector = {};
+  struct msghdr header = {};
+  header.msg_name = peer.size() ? const_cast<void*>(peer.data()) : nullptr;
+  header.msg_namelen = static_cast<socklen_t>(peer.size());
+  header.msg_iov = &vector;
+  header.msg_iovlen = 1;
+  event event(*state, timeout, token);
+  while (!message.empty()) {
+    const auto size = std::min(message.size(), chunk);
+    vector = { const_cast<char*>(message.data()), size };
+    set_segment_size(header, control, static_cast<std::uint16_t>(segment));
+    event.reset();
+    const auto sqe = state->submission(event);
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = handle_;
+    sqe->addr = reinterpret_cast<std::uintptr_t>(&header);
+    sqe->len = 1;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    const auto rv = co_await event;
+    if (rv < 0) {
+      if (rv == -EAGAIN || rv == -EINTR) {
+        continue;
+      }
+      if (rv == -ECANCELED) {
+        co_return { static_cast<int>(errc::cancelled), error_category() };
+      }
+      if (rv == -EIO || rv == -EINVAL || rv == -ENOPROTOOPT) {
+        // The kernel or the network device does not support segmentation offload.
+        std::vector<datagram> datagrams;
+        split(datagrams, peer, message, segment);
+        co_return co_await send_to(datagrams, timeout, token);
+      }
+      co_return { -rv, error_category() };
+    }
+    message.remove_prefix(size);
+  }
+  co_return {};
+}
+
+async<std::error_code> socket::send_to(
+  const std::vector<datagram>& datagrams, std::chrono::milliseconds timeout, cancellation_token token) noexcept {
+  const auto state = events_.get().data();
+  if (!state) {
+    co_return { static_cast<int>(std::errc::bad_file_descriptor), error_category() };
+  }
+  std::vector<iovec> vectors(datagrams.size());
+  std::vector<mmsghdr> messages(datagrams.size());
+  for (std::size_t i = 0; i < datagrams.size(); i++) {
+    const auto& [peer, data] = datagrams[i];
+    vectors[i] = { const_cast<char*>(data.data()), data.size() };
+    messages[i].msg_hdr.msg_name = peer.size() ? const_cast<void*>(peer.data()) : nullptr;
+    messages[i].msg_hdr.msg_namelen = static_cast<socklen_t>(peer.size());
+    messages[i].msg_hdr.msg_iov = &vectors[i];
+    messages[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  // There is no batched send submission, so the datagrams are sent with sendmmsg and the socket is polled when the
+  // socket buffer is full.
+  event event(*state, timeout, token);
+  std::size_t sent = 0;
+  while (sent < messages.size()) {
+    const auto count = static_cast<unsigned>(std::min<std::size_t>(messages.size() - sent, UIO_MAXIOV));
+    const auto rv = ::sendmmsg(handle_, messages.data() + sent, count, MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (rv < 0) {
+      if (errno != EAGAIN) {
+        co_return { errno, error_category() };
+      }
+      poll(*state, event, handle_, POLLOUT);
+      if (const auto result = co_await event; result < 0) {
+        if (result == -ECANCELED) {
+          co_return { static_cast<int>(errc::cancelled), error_category() };
+        }
+        co_return { -result, error_category() };
+      }
+      continue;
+    }
+    sent += static_cast<std::size_t>(rv);
+  }
+  co_return {};
+}
+
+async<std::error_code> socket::send_zerocopy(
+  std::string_view message, std::chrono::milliseconds timeout, cancellation_token token) noexcept {
+  if (message.size() < zerocopy_threshold) {
+    co_return co_await send(message, timeout, token);
+  }
+  const auto state = events_.get().data();
+  if (!state) {
+    co_return { static_cast<int>(std::errc::bad_file_descriptor), error_category() };
+  }
+  event event(*state, timeout, token);
+  auto data = message.data();
+  auto size = message.size();
+  while (size > 0) {
+    event.reset();
+    const auto sqe = state->submission(event);
+    sqe->opcode = IORING_OP_SEND_ZC;
+    sqe->fd = handle_;
+    sqe->addr = reinterpret_cast<std::uintptr_t>(data);
+    sqe->len = static_cast<std::uint32_t>(std::min<std::size_t>(size, std::numeric_limits<std::uint32_t>::max()));
+    sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+    const auto rv = co_await event;
+
+    // The kernel releases the data with a separate notification completion.
+    // Cancellations submitted by the timeout or the token no longer match the completed send.
+    if (event.flags() & IORING_CQE_F_MORE) {
+      event.reset();
+      co_await event;
+    }
+    if (rv < 0) {
+      if (rv == -EAGAIN || rv == -EINTR) {
+        continue;
+      }
+      if (rv == -ECANCELED) {
+        co_return { static_cast<int>(errc::cancelled), error_category() };
+      }
+      if (rv == -EINVAL || rv == -EOPNOTSUPP) {
+        // Kernels before 6.0 and some socket types do not support zero-copy sends.
+        co_return co_await send({ data, size }, timeout, token);
+      }
+      co_return { -rv, error_category() };
+    }
+    if (rv == 0) {
+      co_return { static_cast<int>(errc::eof), error_category() };
+    }
+    const auto bytes = static_cast<std::size_t>(rv);
+    data += bytes;
+    size -= bytes > size ? size : bytes;
+  }
+  co_return {};
+}
+
+async<std::error_code> socket::send_file(
+  int file, std::uint64_t offset, std::uint64_t size, std::chrono::milliseconds timeout,
+  cancellation_token token) noexcept {
+  const auto state = events_.get().data();
+  if (!state) {
+    co_return { static_cast<int>(std::errc::bad_file_descriptor), error_category() };
+  }
+  struct stat st = {};
+  if (::fstat(file, &st) < 0) {
+    co_return { errno, error_category() };
+  }
+
+  // Splice submissions block kernel worker threads, so the socket is polled and written with non-blocking calls.
+  constexpr std::uint64_t limit = std::numeric_limits<ssize_t>::max();
+  event event(*state, timeout, token);
+
+  // Regular files are sent with sendfile.
+  if (S_ISREG(st.st_mode)) {
+    auto position = static_cast<off_t>(offset);
+    while (size > 0) {
+      const auto rv = ::sendfile(handle_, file, &position, static_cast<std::size_t>(std::min(size, limit)));
+      if (rv < 0) {
+        if (errno != EAGAIN) {
+          co_return { errno, error_category() };
+        }
+        poll(*state, event, handle_, POLLOUT);
+        if (const auto result = co_await event; result < 0) {
+          if (result == -ECANCELED) {
+            co_return { static_cast<int>(errc::cancelled), error_category() };
+          }
+          co_return { -result, error_category() };
+        }
+        continue;
+      }
+      if (rv == 0) {
+        break;
+      }
+      size -= static_cast<std::uint64_t>(rv);
+    }
+    co_return {};
+  }
+
+  // Other files are moved to the socket through a pipe with splice.
+  // The pipe is only filled when it is empty, so EAGAIN means that the file has no data or the socket is full.
+  pipe pipe;
+  if (const auto ec = pipe.create()) {
+    co_return ec;
+  }
+  std::size_t buffered = 0;
+  while (buffered > 0 || size > 0) {
+    if (buffered == 0) {
+      const auto rv = ::splice(
+        file, nullptr, pipe.writer(), nullptr, static_cast<std::size_t>(std::min(size, limit)),
+        SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+      if (rv < 0) {
+        if (errno != EAGAIN) {
+          co_return { errno, error_category() };
+        }
+        poll(*state, event, file, POLLIN);
+        if (const auto result = co_await event; result < 0) {
+          if (result == -ECANCELED) {
+            co_return { static_cast<int>(errc::cancelled), error_category() };
+          }
+          co_return { -result, error_category() };
+        }
+        continue;
+      }
+      if (rv == 0) {
+        break;
+      }
+      buffered = static_cast<std::size_t>(rv);
+      size -= static_cast<std::uint64_t>(rv);
+    }
+    const auto rv = ::splice(pipe.reader(), nullptr, handle_, nullptr, buffered, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    if (rv < 0) {
+      if (errno != EAGAIN) {
+        co_return { errno, error_category() };
+      }
+      poll(*state, event, handle_, POLLOUT);
+      if (const auto result = co_await event; result < 0) {
+        if (result == -ECANCELED) {
+          co_return { static_cast<int>(errc::cancelled), error_category() };
+        }
+        co_return { -result, error_category() };
+      }
+      continue;
+    }
+    buffered -= static_cast<std::size_t>(rv);
+  }
+  co_return {};
+}
+
+async<std::error_code> socket::splice(
+  socket& other, std::uint64_t& count, std::chrono::milliseconds timeout, cancellation_token token) noexcept {
+  const auto state = events_.get().data();
+  if (!state) {
+    co_return { static_cast<int>(std::errc::bad_file_descriptor), error_category() };
+  }
+  pipe pipe;
+  if (const auto ec = pipe.create()) {
+    co_return ec;
+  }
+
+  // Splice submissions block kernel worker threads, so the sockets are polled and spliced with non-blocking calls.
+  // The pipe is only filled when it is empty, so EAGAIN means that the socket has no data or the other socket is full.
+  event event(*state, timeout, token);
+  constexpr std::size_t limit = std::numeric_limits<ssize_t>::max();
+  std::size_t buffered = 0;
+  while (true) {
+    if (buffered == 0) {
+      const auto rv = ::splice(handle_, nullptr, pipe.writer(), nullptr, limit, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+      if (rv < 0) {
+        if (errno != EAGAIN) {
+          co_return { errno, error_category() };
+        }
+        poll(*state, event, handle_, POLLIN);
+        if (const auto result = co_await event; result < 0) {
+          if (result == -ECANCELED) {
+            co_return { static_cast<int>(errc::cancelled), error_category() };
+          }
+          co_return { -result, error_category() };
+        }
+        continue;
+      }
+      if (rv == 0) {
+        if (::shutdown(other.handle_, SHUT_WR) < 0) {
+          co_return { errno, error_category() };
+        }
+        co_return {};
+      }
+      buffered = static_cast<std::size_t>(rv);
+    }
+    const auto rv =
+      ::splice(pipe.reader(), nullptr, other.handle_, nullptr, buffered, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    if (rv < 0) {
+      if (errno != EAGAIN) {
+        co_return { errno, error_category() };
+      }
+      poll(*state, event, other.handle_, POLLOUT);
+      if (const auto result = co_await event; result < 0) {
+        if (result == -ECANCELED) {
+          co_return { static_cast<int>(errc::cancelled), error_category() };
+        }
+        co_return { -result, error_category() };
+      }
+      continue;
+    }
+    buffered -= static_cast<std::size_t>(rv);
+    count += static_cast<std::uint64_t>(rv);
+  }
+  co_return {};
+}
+
+// clang-format on
+
+std::error_code socket::close() noexcept {
+  if (valid()) {
+    ::shutdown(handle_, SHUT_RDWR);
+    if (::close(handle_) < 0) {
+      return { errno, error_category() };
+    }
+    handle_ = invalid_handle_value;
+  }
+  return {};
+}
+
+}  // namespace coronet
@@ -0,0 +1,162 @@
+#pragma once
+#include <coronet/timer.h>
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <cstddef>
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace coronet {
+
+// Hierarchical timing wheel with millisecond resolution.
+// Timers are armed and cancelled in constant time and move to lower levels as their expiry approaches.
+class wheel final {
+public:
+  // Number of slots per level is 2^bits and each level is 2^bits times coarser than the previous one.
+  constexpr static unsigned bits = 6;
+  constexpr static unsigned slots = 1U << bits;
+  constexpr static unsigned levels = 6;
+
+  // Longest supported duration in milliseconds (about 795 days).
+  constexpr static std::uint64_t range = std::uint64_t(1) << (bits * levels);
+
+  // Returned by timeout when no timer is armed.
+  constexpr static std::uint64_t infinite = std::numeric_limits<std::uint64_t>::max();
+
+  wheel() noexcept : now_(ticks()) {
+  }
+
+  wheel(wheel&& other) = delete;
+  wheel& operator=(wheel&& other) = delete;
+
+  ~wheel() = default;
+
+  // Arms the timer to expire after the given duration.
+  void start(timer& timer, std::chrono::milliseconds duration) noexcept {
+    cancel(timer);
+    const auto now = std::max(ticks(), now_);
+    const auto count = static_cast<std::uint64_t>(std::max(duration.count(), std::chrono::milliseconds::rep(1)));
+    timer.expiry_ = std::min(now + count, now_ + range - 1);
+    insert(timer);
+  }
+
+  // Disarms the timer.
+  void cancel(timer& timer) noexcept {
+    if (!timer.bucket_) {
+      return;
+    }
+    if (timer.prev_) {
+      timer.prev_->next_ = timer.next_;
+    } else {
+      *timer.bucket_ = timer.next_;
+      if (!timer.next_) {
+        const auto index = static_cast<std::size_t>(timer.bucket_ - &buckets_[0][0]);
+        occupied_[index / slots] &= ~(std::uint64_t(1) << (index % slots));
+      }
+    }
+    if (timer.next_) {
+      timer.next_->prev_ = timer.prev_;
+    }
+    timer.prev_ = nullptr;
+    timer.next_ = nullptr;
+    timer.bucket_ = nullptr;
+  }
+
+  // Returns the number of milliseconds until the wheel has to be advanced or infinite when no timer is armed.
+  std::uint64_t timeout() const noexcept {
+    auto timeout = infinite;
+    for (unsigned level = 0; level < levels; level++) {
+      if (!occupied_[level]) {
+        continue;
+      }
+      const auto shift = bits * level;
+      const auto base = now_ >> shift;
+      const auto start = static_cast<unsigned>((base + 1) & (slots - 1));
+      const auto steps = countr_zero(rotr(occupied_[level], start)) + 1;
+      timeout = std::min(timeout, ((base + steps) << shift) - now_);
+    }
+    return timeout;
+  }
+
+  // Advances the wheel to the current time and calls expired timers.
+  void advance() noexcept {
+    const auto now = ticks();
+    while (now_ < now) {
+      const auto timeout = this->timeout();
+      if (timeout == infinite || now_ + timeout > now) {
+        now_ = now;
+        break;
+      }
+      now_ += timeout;
+
+      // Move timers from coarser levels whose slot starts now.
+      for (unsigned level = 1; level < levels; level++) {
+        const auto shift = bits * level;
+        if (now_ & ((std::uint64_t(1) << shift) - 1)) {
+          break;
+        }
+        auto& bucket = buckets_[level][(now_ >> shift) & (slots - 1)];
+        while (const auto timer = bucket) {
+          cancel(*timer);
+          insert(*timer);
+        }
+      }
+
+      // Call expired timers. Timers that are armed by callbacks expire in later slots.
+      auto& bucket = buckets_[0][now_ & (slots - 1)];
+      while (const auto timer = bucket) {
+        cancel(*timer);
+        (*timer)();
+      }
+    }
+  }
+
+private:
+  static std::uint64_t ticks() noexcept {
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(now).count());
+  }
+
+  static std::uint64_t rotr(std::uint64_t value, unsigned count) noexcept {
+    return (value >> count) | (value << ((64 - count) & 63));
+  }
+
+  static std::uint64_t countr_zero(std::uint64_t value) noexcept {
+#ifdef _MSC_VER
+    unsigned long index = 0;
+    _BitScanForward64(&index, value);
+    return index;
+#else
+    return static_cast<std::uint64_t>(__builtin_ctzll(value));
+#endif
+  }
+
+  // Links the timer into the finest level that covers its expiry.
+  void insert(timer& timer) noexcept {
+    const auto delta = timer.expiry_ > now_ ? timer.expiry_ - now_ : 0;
+    unsigned level = 0;
+    while (level + 1 < levels && delta >= std::uint64_t(1) << (bits * (level + 1))) {
+      level++;
+    }
+    const auto slot = static_cast<unsigned>((timer.expiry_ >> (bits * level)) & (slots - 1));
+    auto& bucket = buckets_[level][slot];
+    timer.prev_ = nullptr;
+    timer.next_ = bucket;
+    if (bucket) {
+      bucket->prev_ = &timer;
+    }
+    bucket = &timer;
+    timer.bucket_ = &bucket;
+    occupied_[level] |= std::uint64_t(1) << slot;
+  }
+
+  std::uint64_t now_ = 0;
+  std::uint64_t occupied_[levels] = {};
+  timer* buckets_[levels][slots] = {};
+};
+
+}  // namespace coronet
@@ -0,0 +1,189 @@
+#include <coronet/async.h>
+#include <coronet/events.h>
+#include <coronet/pipeline.h>
+#include <coronet/read_ahead.h>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <utility>
+
+// Measures the cost of handing a single item from the producer to the consumer.
+// The atomic async_generator is the baseline for the single-threaded local_async_generator.
+// The layered and fused pipelines apply the same stages with one generator per stage and with a single generator.
+// The read-ahead benchmark compares a slow producer and a slow consumer in lockstep and with a read-ahead buffer.
+
+using namespace std::chrono_literals;
+
+// Counts the producers that are still alive, so that consumers that stop early can be checked for leaks.
+class producer final {
+public:
+  producer() noexcept {
+    count++;
+  }
+
+  producer(producer&& other) = delete;
+  producer& operator=(producer&& other) = delete;
+
+  ~producer() {
+    count--;
+  }
+
+  static inline std::size_t count = 0;
+};
+
+void report(const char* name, std::size_t count, std::chrono::steady_clock::duration duration) noexcept {
+  const auto ms = std::chrono::duration<double, std::milli>(duration).count();
+  std::cout << std::setw(32) << std::left << name << std::setw(8) << std::right << std::fixed << std::setprecision(2)
+            << ms << " ms (items: " << count << ")\n";
+}
+
+void check(const char* name, std::size_t count) noexcept {
+  std::cout << std::setw(32) << std::left << name << std::setw(8) << std::right << producer::count
+            << " producers (items: " << count << ")\n";
+}
+
+// clang-format off
+
+template <typename Generator>
+Generator produce(std::size_t count) noexcept {
+  for (std::size_t i = 0; i < count; i++) {
+    co_yield i;
+  }
+}
+
+template <typename Generator>
+coronet::task consume(std::size_t count, std::size_t& sum) noexcept {
+  for co_await(const auto value : produce<Generator>(count)) {
+    sum += value;
+  }
+  co_return;
+}
+
+coronet::local_async_generator<std::size_t> twice(coronet::local_async_generator<std::size_t> values) noexcept {
+  for co_await(const auto value : values) {
+    co_yield value * 2;
+  }
+}
+
+coronet::local_async_generator<std::size_t> multiple_of_four(
+  coronet::local_async_generator<std::size_t> values) noexcept {
+  for co_await(auto value : values) {
+    if (value % 4 == 0) {
+      co_yield value;
+    }
+  }
+}
+
+coronet::task layered(std::size_t count, std::size_t& sum) noexcept {
+  auto values = produce<coronet::local_async_generator<std::size_t>>(count);
+  for co_await(const auto value : multiple_of_four(twice(std::move(values)))) {
+    sum += value;
+  }
+  co_return;
+}
+
+coronet::task fused(std::size_t count, std::size_t& sum) noexcept {
+  auto values = produce<coronet::local_async_generator<std::size_t>>(count) |
+    coronet::transform([](std::size_t value) { return value * 2; }) |
+    coronet::filter([](std::size_t value) { return value % 4 == 0; });
+  for co_await(const auto value : values) {
+    sum += value;
+  }
+  co_return;
+}
+
+coronet::task buffered(std::size_t count, std::size_t& sum) noexcept {
+  auto values = produce<coronet::local_async_generator<std::size_t>>(count);
+  for co_await(const auto value : coronet::read_ahead(std::move(values), 16)) {
+    sum += value;
+  }
+  co_return;
+}
+
+coronet::async_generator<std::size_t> delayed(
+  coronet::events& events, std::size_t count, std::chrono::milliseconds delay) noexcept {
+  producer producer;
+  for (std::size_t i = 0; i < count; i++) {
+    co_await events.sleep_for(delay);
+    co_yield i;
+  }
+}
+
+// Returns the number of items that were received in order.
+template <typename Generator>
+coronet::lazy<std::size_t> process(
+  coronet::events& events, Generator values, std::chrono::milliseconds delay, std::size_t limit) noexcept {
+  std::size_t count = 0;
+  for co_await(const auto value : values) {
+    if (value != count) {
+      break;
+    }
+    co_await events.sleep_for(delay);
+    if (++count == limit) {
+      break;
+    }
+  }
+  co_return count;
+}
+
+coronet::task latency(coronet::events& events, std::size_t count, std::chrono::milliseconds delay) noexcept {
+  auto tp0 = std::chrono::steady_clock::now();
+  auto items = co_await process(events, delayed(events, count, delay), delay, count);
+  report("lockstep", items, std::chrono::steady_clock::now() - tp0);
+
+  tp0 = std::chrono::steady_clock::now();
+  items = co_await process(events, coronet::read_ahead(delayed(events, count, delay), 4), delay, count);
+  report("read_ahead", items, std::chrono::steady_clock::now() - tp0);
+
+  // Stop early while the producer is suspended in the full buffer. The producer is destroyed with the buffer.
+  items = co_await process(events, coronet::read_ahead(delayed(events, count, 1ms), 2), delay, 2);
+  check("read_ahead early stop (full)", items);
+
+  // Stop early while the producer waits for the next item. The producer destroys itself when it yields.
+  items = co_await process(events, coronet::read_ahead(delayed(events, count, delay * 4), 2), 1ms, 2);
+  check("read_ahead early stop (waiting)", items);
+  co_await events.sleep_for(delay * 8);
+  check("read_ahead early stop (yielded)", items);
+  events.stop();
+}
+
+// clang-format on
+
+void benchmark(const char* name, std::size_t count, coronet::task (*consume)(std::size_t, std::size_t&)) noexcept {
+  std::size_t sum = 0;
+  const auto tp0 = std::chrono::steady_clock::now();
+  consume(count, sum);
+  const auto tp1 = std::chrono::steady_clock::now();
+  const auto ns = std::chrono::duration<double, std::nano>(tp1 - tp0).count();
+  std::cout << std::setw(32) << std::left << name << std::setw(8) << std::right << std::fixed << std::setprecision(2)
+            << ns / static_cast<double>(count) << " ns/item (sum: " << sum << ")\n";
+}
+
+template <typename Generator>
+void benchmark(const char* name, std::size_t count) noexcept {
+  benchmark(name, count, consume<Generator>);
+}
+
+int main(int argc, char* argv[]) {
+  const auto count = argc > 1 ? std::stoull(argv[1]) : 100000000ull;
+  for (auto i = 0; i < 3; i++) {
+    benchmark<coronet::async_generator<std::size_t>>("async_generator", count);
+    benchmark<coronet::local_async_generator<std::size_t>>("local_async_generator", count);
+    benchmark("layered pipeline", count, layered);
+    benchmark("fused pipeline", count, fused);
+    benchmark("read_ahead", count, buffered);
+  }
+
+  // Measure a producer and a consumer that both wait 10 ms per item.
+  coronet::events events;
+  if (const auto ec = events.create()) {
+    std::cerr << "could not create events queue: " << ec.message() << '\n';
+    return ec.value();
+  }
+  latency(events, 20, 10ms);
+  if (const auto ec = events.run()) {
+    std::cerr << "could not run events queue: " << ec.message() << '\n';
+    return ec.value();
+  }
+}
@@ -1,10 +1,25 @@
 #include <coronet/events.h>
+#include <coronet/runtime.h>
 #include <coronet/server.h>
 #include <coronet/socket.h>
 #include <coronet/signal.h>
+#include <atomic>
 #include <iomanip>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <vector>
+
+// Stops accepting connections and closes idle connections when it is posted to the events queue of a server.
+// Connections finish sending the data that they already received.
+class drain final : public coronet::work {
+public:
+  void operator()() noexcept override {
+    scope.cancel();
+  }
+
+  coronet::task_scope scope;
+};
 
 // clang-format off
 
@@ -12,32 +27,42 @@ std::ostream& operator<<(std::ostream& os, const std::error_code& ec) noexcept {
   return os << '[' << ec.category().name() << ':' << ec.value() << ']';
 }
 
-coronet::task handle(coronet::socket socket, std::size_t bufs) noexcept {
+coronet::task handle(
+  coronet::scope_arg_t, coronet::task_scope& scope, coronet::socket socket, std::size_t bufs) noexcept {
   std::string buffer;
   buffer.resize(bufs);
-  for co_await(const auto data : socket.recv(buffer.data(), buffer.size())) {
+  for co_await(const auto data : socket.recv(buffer.data(), buffer.size(), {}, scope.token())) {
     if (const auto ec = co_await socket.send(data)) {
       std::cerr << socket << ": " << ec << " send error: " << ec.message() << '\n';
       break;
     }
   }
-  if (const auto ec = socket.ec(); ec != coronet::errc::eof) {
+  if (const auto ec = socket.ec(); ec != coronet::errc::eof && ec != coronet::errc::cancelled) {
     std::cerr << socket << ": " << ec << " recv error: " << ec.message() << '\n';
   }
   co_return;
 }
 
-coronet::task accept(coronet::server& server, std::size_t bufs) noexcept {
-  for co_await(auto&& socket : server.accept()) {
+coronet::task accept(
+  coronet::runtime& runtime, coronet::server& server, coronet::task_scope& scope, std::atomic_size_t& servers,
+  std::size_t bufs) noexcept {
+  for co_await(auto&& socket : server.accept(0, {}, scope.token())) {
     if (const auto ec = socket.set(coronet::option::nodelay, true)) {
       std::cerr << socket << ": " << ec << " set nodelay error: " << ec.message() << '\n';
     }
-    handle(std::move(socket), bufs);
+    handle(coronet::scope_arg, scope, std::move(socket), bufs);
   }
-  if (const auto ec = server.ec()) {
+  if (const auto ec = server.ec(); ec && ec != coronet::errc::cancelled) {
     std::cerr << ec << " accept error: " << ec.message() << '\n';
   }
-  std::cout << "server stopped\n";
+  if (const auto ec = server.stop()) {
+    std::cerr << ec << " stop error: " << ec.message() << '\n';
+  }
+  co_await scope.join();
+  if (--servers == 0) {
+    std::cout << "server stopped\n";
+    runtime.stop();
+  }
   co_return;
 }
 
@@ -47,31 +72,72 @@ int main(int argc, char* argv[]) {
   const auto host = argc > 1 ? argv[1] : "127.0.0.1";
   const auto port = argc > 2 ? argv[2] : "8080";
   const auto bufs = argc > 3 ? std::stoull(argv[3]) : 40960ull;
+  const auto size = argc > 4 ? std::stoull(argv[4]) : 1ull;  // event loops, 0 for one per processor
+  const auto mode = argc > 5 ? std::string(argv[5]) : "shared";  // shared, reuseport or cpu listening sockets
   std::cout << std::boolalpha;
 
-  // Create event loop.
-  coronet::events events;
-  if (const auto ec = events.create()) {
+  // Create event loops.
+  coronet::runtime runtime;
+  if (const auto ec = runtime.create(size)) {
     std::cerr << ec << " create events error: " << ec.message() << std::endl;
     return ec.value();
   }
 
-  // Trap SIGINT signal.
-  coronet::signal(SIGINT, [&](int signum) { events.close(); });
+  // Create TCP Server for each event loop.
+  // Shared mode duplicates a single listening socket, reuseport mode binds one listening socket per event loop
+  // and cpu mode additionally hands connections to the event loop on the processor that received them.
+  std::vector<coronet::server> servers;
+  servers.reserve(runtime.size());
+  const auto reuseport = mode == "reuseport" || mode == "cpu";
+  for (auto& events : runtime) {
+    auto& server = servers.emplace_back(events);
+    std::error_code ec;
+    if (servers.size() > 1 && !reuseport) {
+      ec = server.create(servers.front());
+    } else {
+      ec = server.create(host, port, coronet::type::tcp, reuseport);
+    }
+    if (ec) {
+      std::cerr << ec << " create server error: " << ec.message() << std::endl;
+      return ec.value();
+    }
+  }
 
-  // Create TCP Server.
-  coronet::server server(events);
-  if (const auto ec = server.create(host, port, coronet::type::tcp)) {
-    std::cerr << ec << " create server error: " << ec.message() << std::endl;
-    return ec.value();
+  // Steer connections to event loops.
+  if (mode == "cpu") {
+    std::vector<int> processors;
+    for (std::size_t i = 0; i < runtime.size(); i++) {
+      processors.push_back(runtime.processor(i));
+    }
+    if (const auto ec = servers.front().steer(processors)) {
+      std::cerr << ec << " steer error: " << ec.message() << std::endl;
+      return ec.value();
+    }
   }
 
   // Accept incoming connections.
-  accept(server, bufs);
+  std::atomic_size_t running = servers.size();
+  const auto drains = std::make_unique<drain[]>(servers.size());
+  for (std::size_t i = 0; i < servers.size(); i++) {
+    accept(runtime, servers[i], drains[i].scope, running, bufs);
+  }
+
+  // Trap SIGINT signal.
+  // The first signal drains connections and the second one stops the event loops immediately.
+  std::atomic_bool draining = false;
+  coronet::signal(SIGINT, [&](int signum) {
+    if (draining.exchange(true)) {
+      runtime.stop();
+      return;
+    }
+    for (std::size_t i = 0; i < runtime.size(); i++) {
+      runtime[i].post(drains[i]);
+    }
+  });
 
-  // Run event loop.
-  std::cout << host << ':' << port << '\n';
-  if (const auto ec = events.run()) {
+  // Run event loops.
+  std::cout << host << ':' << port << " (" << runtime.size() << " event loops, " << mode << ")\n";
+  if (const auto ec = runtime.run()) {
     std::cerr << ec << ' ' << ec.message() << std::endl;
     return ec.value();
   }